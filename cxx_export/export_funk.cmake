@@ -0,0 +1,29 @@
+# =============================================================================
+#   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+# =============================================================================
+#   Exports Funk.mid and compares it against the export.py dump in the repo
+execute_process(
+    COMMAND ${EXPORTER} ${ROOT}/Funk.mid ${OUTPUT} ${ROOT}/sample_pack
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "axsd_export failed with ${result}")
+endif()
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT} ${ROOT}/Funk.axsd
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${OUTPUT} differs from Funk.axsd")
+endif()
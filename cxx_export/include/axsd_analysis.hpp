@@ -0,0 +1,176 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// AxolotlSD song analysis, what a song will cost before it is played
+#pragma once
+#include "axsd_reader.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace axolotlsd::format {
+// Drums are played on this MIDI channel, as in General MIDI
+constexpr static U8 DRUM_CHANNEL = 9;
+
+/// @brief Up-front cost of a song, for picking polyphony and placing sessions
+struct song_analysis {
+  // From the end of track record
+  double duration_seconds;
+  // Most voices sounding at once, a player with fewer will steal voices
+  U32 peak_voices;
+  // Voices sounding on average over the song
+  double mean_voices;
+  double events_per_second;
+  // Decoded samples, what the bank takes in memory once loaded
+  std::size_t bank_bytes;
+  // Voice frames mixed per second of audio at the analysed sample rate,
+  // multiply by the cost per voice frame, (mix/full_polyphony - mix/silent)
+  // / (32 * 1024) from axolotlsd_bench, and add the per buffer cost
+  // mix/silent to get CPU time
+  double voice_frames_per_second;
+};
+
+/// @brief Simulates note lifetimes over the event table
+///
+/// Every note on starts a voice, so a note retriggered before its release
+/// sounds twice. Looping patches sound until a keyed note off or zero
+/// velocity note on releases the oldest voice of that note, or a note off
+/// releases their channel. Drums and non-looping patches also stop once their
+/// sample has played, its length at `sample_rate` scaled by its pitch. Notes
+/// without a drum or patch in the bank are silent.
+inline song_analysis analyze(const song_image &song, U32 sample_rate) {
+  auto result = song_analysis{.duration_seconds = 0.0,
+                              .peak_voices = 0,
+                              .mean_voices = 0.0,
+                              .events_per_second = 0.0,
+                              .bank_bytes = song.bank_bytes(),
+                              .voice_frames_per_second = 0.0};
+  if (song.tick_rate == 0) {
+    return result;
+  }
+  result.duration_seconds = static_cast<double>(song.end_tick) / song.tick_rate;
+
+  // How long each drum and patch plays out, by id, infinite for looping
+  // patches and negative when the bank lacks it
+  auto drum_seconds = std::vector<double>(256, -1.0);
+  auto patch_seconds = std::vector<double>(256, -1.0);
+  for (const auto &entry : song.bank) {
+    auto seconds = HUGE_VAL;
+    if (entry.pitch > 0.0f && sample_rate > 0) {
+      seconds =
+          entry.frames / (static_cast<double>(sample_rate) * entry.pitch);
+    }
+    if (entry.drum) {
+      drum_seconds[entry.id] = seconds;
+    } else {
+      patch_seconds[entry.id] =
+          entry.loop_start == NO_LOOP ? seconds : HUGE_VAL;
+    }
+  }
+
+  struct voice {
+    U8 channel;
+    U8 note;
+    double ends;
+  };
+  // In the order they started, so releases find the oldest first
+  auto voices = std::vector<voice>{};
+  auto programs = std::vector<U8>(16, 0);
+  auto voice_seconds = 0.0;
+  auto now = 0.0;
+  // Advances to `until`, retiring voices that finish on the way
+  auto advance = [&](double until) {
+    while (true) {
+      auto next = until;
+      for (const auto &playing : voices) {
+        next = std::min(next, playing.ends);
+      }
+      voice_seconds += voices.size() * (next - now);
+      now = next;
+      std::erase_if(voices,
+                    [&](const voice &playing) { return playing.ends <= now; });
+      if (next >= until) {
+        return;
+      }
+    }
+  };
+  auto release = [&](U8 channel, U8 note) {
+    auto found = std::find_if(voices.begin(), voices.end(),
+                              [&](const voice &playing) {
+                                return playing.channel == channel &&
+                                       playing.note == note;
+                              });
+    if (found != voices.end()) {
+      voices.erase(found);
+    }
+  };
+
+  for (const auto &group : song.groups) {
+    advance(static_cast<double>(group.tick) / song.tick_rate);
+    for (auto i = group.first; i < group.first + group.count; i++) {
+      const auto &ev = song.events[i];
+      auto drum = ev.channel == DRUM_CHANNEL;
+      switch (ev.op) {
+      case opcode::note_on: {
+        if (ev.velocity == 0) {
+          if (!drum) {
+            release(ev.channel, ev.note);
+          }
+          break;
+        }
+        auto seconds = drum ? drum_seconds[ev.note]
+                            : patch_seconds[programs[ev.channel & 0x0F]];
+        if (seconds > 0.0) {
+          voices.emplace_back(voice{
+              .channel = ev.channel, .note = ev.note, .ends = now + seconds});
+        }
+        break;
+      }
+      case opcode::note_off_keyed: {
+        if (!drum) {
+          release(ev.channel, ev.note);
+        }
+        break;
+      }
+      case opcode::note_off: {
+        if (!drum) {
+          std::erase_if(voices, [&](const voice &playing) {
+            return playing.channel == ev.channel;
+          });
+        }
+        break;
+      }
+      case opcode::program_change: {
+        programs[ev.channel & 0x0F] = ev.note;
+        break;
+      }
+      default: {
+        break;
+      }
+      }
+    }
+    result.peak_voices =
+        std::max(result.peak_voices, static_cast<U32>(voices.size()));
+  }
+  advance(std::max(now, result.duration_seconds));
+
+  if (result.duration_seconds > 0.0) {
+    result.mean_voices = voice_seconds / result.duration_seconds;
+    result.events_per_second = song.events.size() / result.duration_seconds;
+    result.voice_frames_per_second = result.mean_voices * sample_rate;
+  }
+  return result;
+}
+} // namespace axolotlsd::format
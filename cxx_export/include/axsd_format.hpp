@@ -0,0 +1,430 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// AxolotlSD sequencer dump format, the records song::load understands
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace axolotlsd::format {
+using U8 = std::uint8_t;
+using U16 = std::uint16_t;
+using U32 = std::uint32_t;
+using S32 = std::int32_t;
+using F32 = float;
+
+constexpr static U8 MAGIC[] = {'A', 'X', 'S', 'D'};
+// Dumps using only the records export.py writes, what song::load reads
+constexpr static U16 VERSION = 0x0003;
+// Dumps using any record past those, so an older loader rejects them instead
+// of misreading them
+constexpr static U16 VERSION_EXTENDED = 0x0004;
+// Sequencer ticks per second, export.py calls this RATE
+constexpr static U32 TICK_RATE = 60;
+
+/// @brief Record opcodes, each record is an opcode then little-endian fields
+enum class opcode : U8 {
+  // <BIBBB> tick, channel, note, velocity
+  note_on = 0x01,
+  // <BIB> tick, channel
+  note_off = 0x02,
+  // <BIBi> tick, channel, bend (-8192 to 8191)
+  pitch_bend = 0x03,
+  // <BIBB> tick, channel, program
+  program_change = 0x04,
+  // <BIBB> tick, channel, note, releases only that note where note_off
+  // releases the channel
+  note_off_keyed = 0x05,
+  // <BBIIIfff> patch, frames, loop start, loop end, pitch, gain L, gain R,
+  // then `frames` unsigned 8-bit samples
+  patch = 0x80,
+  // <BBIfff> drum, frames, pitch, gain L, gain R, then `frames` samples
+  drum = 0x81,
+  // <BBIIIfffBI> patch fields, then codec and payload size, then payload,
+  // also the only way to store 16-bit samples
+  encoded_patch = 0x82,
+  // <BBIfffBI> drum fields, then codec and payload size, then payload
+  encoded_drum = 0x83,
+  // <BIH> tick and 1/65536ths of a tick the song loops back to
+  loop_start = 0xFA,
+  // <BIH> tick and 1/65536ths of a tick the song loops at, only written
+  // after a loop_start
+  loop_end = 0xFB,
+  // <BH> format version
+  version = 0xFC,
+  // <BI> sequencer ticks per second
+  tick_rate = 0xFD,
+  // <BI> tick the song ends on
+  end_of_track = 0xFE,
+};
+
+/// @brief How the samples of an encoded patch or drum are stored
+enum class codec : U8 {
+  // `frames` unsigned 8-bit samples, same as the plain records
+  pcm_u8 = 0x00,
+  // First sample, initial step index, then 4-bit IMA ADPCM codes for the
+  // remaining frames, low nibble first, decodes to unsigned 8-bit
+  adpcm4 = 0x01,
+  // <BB> 0 for a drum or 1 for a patch, then its id, both defined earlier in
+  // the bank with identical samples
+  reference = 0x02,
+  // `frames` signed 16-bit little-endian samples
+  pcm_s16 = 0x03,
+  // Same as adpcm4 with a 16-bit first sample, decodes to signed 16-bit
+  adpcm4_s16 = 0x04,
+};
+
+// Loop start and end of a patch that does not loop
+constexpr static U32 NO_LOOP = 0xFFFFFFFF;
+
+constexpr static U8 REFERENCE_DRUM = 0;
+constexpr static U8 REFERENCE_PATCH = 1;
+
+/// @brief Per sample type details, so code handling samples can be written
+/// once and instantiated for each format
+template <typename T> struct sample_format;
+
+template <> struct sample_format<U8> {
+  constexpr static auto width = 1;
+  constexpr static auto pcm = codec::pcm_u8;
+  constexpr static auto adpcm = codec::adpcm4;
+
+  static std::int32_t to_s16(U8 value) { return (value - 128) << 8; }
+  // Rounds to nearest, truncating would bias every sample down by half a step
+  static U8 from_s16(std::int32_t value) {
+    auto rounded = (value + 128) >> 8;
+    return static_cast<U8>((rounded > 127 ? 127 : rounded) + 128);
+  }
+  static U8 read(const U8 *bytes) { return bytes[0]; }
+  static void write(std::vector<U8> &bytes, U8 value) {
+    bytes.emplace_back(value);
+  }
+};
+
+template <> struct sample_format<std::int16_t> {
+  constexpr static auto width = 2;
+  constexpr static auto pcm = codec::pcm_s16;
+  constexpr static auto adpcm = codec::adpcm4_s16;
+
+  static std::int32_t to_s16(std::int16_t value) { return value; }
+  static std::int16_t from_s16(std::int32_t value) {
+    return static_cast<std::int16_t>(value);
+  }
+  static std::int16_t read(const U8 *bytes) {
+    return static_cast<std::int16_t>(bytes[0] | (bytes[1] << 8));
+  }
+  static void write(std::vector<U8> &bytes, std::int16_t value) {
+    bytes.emplace_back(static_cast<U16>(value) & 0xFF);
+    bytes.emplace_back(static_cast<U16>(value) >> 8);
+  }
+};
+
+/// @brief Unpacks little-endian PCM bytes into samples
+template <typename T>
+std::vector<T> unpack_pcm(const U8 *bytes, std::size_t size) {
+  auto samples = std::vector<T>{};
+  samples.reserve(size / sample_format<T>::width);
+  for (auto i = std::size_t{0}; i + sample_format<T>::width <= size;
+       i += sample_format<T>::width) {
+    samples.emplace_back(sample_format<T>::read(&bytes[i]));
+  }
+  return samples;
+}
+
+// ============================================================================
+// IMA ADPCM, worked in the 16-bit domain whatever the sample type
+// ============================================================================
+constexpr static std::int16_t ADPCM_STEPS[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+constexpr static std::int8_t ADPCM_INDEX_STEP[8] = {-1, -1, -1, -1,
+                                                    2,  4,  6,  8};
+
+/// @brief Decoder state, small enough for a voice to decode lazily, though a
+/// looping voice has to keep a copy of the state at its loop start
+struct adpcm4_state {
+  std::int32_t predictor;
+  std::int32_t index;
+
+  static adpcm4_state from(std::int32_t predictor, U8 index) {
+    return adpcm4_state{.predictor = predictor,
+                        .index = index > 88 ? 88 : index};
+  }
+  void next(U8 code) {
+    auto step = std::int32_t{ADPCM_STEPS[index]};
+    auto delta = step >> 3;
+    if (code & 4) {
+      delta += step;
+    }
+    if (code & 2) {
+      delta += step >> 1;
+    }
+    if (code & 1) {
+      delta += step >> 2;
+    }
+    predictor += (code & 8) ? -delta : delta;
+    predictor = predictor < -32768 ? -32768
+                                   : (predictor > 32767 ? 32767 : predictor);
+    index += ADPCM_INDEX_STEP[code & 7];
+    index = index < 0 ? 0 : (index > 88 ? 88 : index);
+  }
+};
+
+/// @brief Encodes samples as 4-bit ADPCM, a half (8-bit) or a quarter
+/// (16-bit) of the PCM size
+template <typename T>
+std::vector<U8> adpcm4_encode(const std::vector<T> &frames) {
+  using traits = sample_format<T>;
+  auto payload = std::vector<U8>{};
+  if (frames.empty()) {
+    return payload;
+  }
+  // Start from the smallest step that covers the first jump
+  auto first_index = U8{0};
+  if (frames.size() > 1) {
+    auto jump = std::abs(traits::to_s16(frames[1]) - traits::to_s16(frames[0]));
+    while (first_index < 88 && ADPCM_STEPS[first_index] < jump) {
+      first_index++;
+    }
+  }
+  traits::write(payload, frames[0]);
+  payload.emplace_back(first_index);
+  auto state = adpcm4_state::from(traits::to_s16(frames[0]), first_index);
+  for (auto i = std::size_t{1}; i < frames.size(); i++) {
+    // Quantize against the decoder's own prediction so error can't drift
+    auto difference = traits::to_s16(frames[i]) - state.predictor;
+    auto step = std::int32_t{ADPCM_STEPS[state.index]};
+    auto code = U8{0};
+    if (difference < 0) {
+      code = 8;
+      difference = -difference;
+    }
+    if (difference >= step) {
+      code |= 4;
+      difference -= step;
+    }
+    if (difference >= step >> 1) {
+      code |= 2;
+      difference -= step >> 1;
+    }
+    if (difference >= step >> 2) {
+      code |= 1;
+    }
+    state.next(code);
+    if (i % 2 == 1) {
+      payload.emplace_back(code);
+    } else {
+      payload.back() |= code << 4;
+    }
+  }
+  return payload;
+}
+
+/// @brief Decodes a whole ADPCM payload back to `frames` samples
+template <typename T>
+std::vector<T> adpcm4_decode(const U8 *payload, std::size_t size,
+                             U32 frames) {
+  using traits = sample_format<T>;
+  constexpr auto header = traits::width + 1;
+  auto samples = std::vector<T>{};
+  if (frames == 0 || size < header + frames / 2) {
+    return samples;
+  }
+  samples.reserve(frames);
+  auto state = adpcm4_state::from(traits::to_s16(traits::read(payload)),
+                                  payload[traits::width]);
+  samples.emplace_back(traits::from_s16(state.predictor));
+  for (auto i = U32{1}; i < frames; i++) {
+    auto byte = payload[header + (i - 1) / 2];
+    state.next(i % 2 == 1 ? byte & 0x0F : byte >> 4);
+    samples.emplace_back(traits::from_s16(state.predictor));
+  }
+  return samples;
+}
+
+/// @brief Signal to noise ratio of `decoded` against `original` in dB,
+/// infinite when they match
+template <typename T>
+double snr_db(const std::vector<T> &original, const std::vector<T> &decoded) {
+  using traits = sample_format<T>;
+  auto signal = 0.0;
+  auto noise = 0.0;
+  for (auto i = std::size_t{0}; i < original.size(); i++) {
+    auto want = static_cast<double>(traits::to_s16(original[i]));
+    auto got = i < decoded.size() ? traits::to_s16(decoded[i]) : 0;
+    signal += want * want;
+    noise += (want - got) * (want - got);
+  }
+  if (noise == 0.0) {
+    return HUGE_VAL;
+  }
+  return 10.0 * std::log10(signal / noise);
+}
+
+/// @brief Appends records to an in-memory dump, written out in one go
+struct writer {
+  std::vector<U8> bytes;
+  // Set by any record beyond what export.py writes
+  bool extended = false;
+
+  void u8(U8 value) { bytes.emplace_back(value); }
+  void u16(U16 value) {
+    u8(value & 0xFF);
+    u8(value >> 8);
+  }
+  void u32(U32 value) {
+    for (auto i = 0; i < 4; i++) {
+      u8((value >> (i * 8)) & 0xFF);
+    }
+  }
+  void s32(S32 value) { u32(static_cast<U32>(value)); }
+  void f32(F32 value) {
+    auto bits = U32{0};
+    std::memcpy(&bits, &value, sizeof(bits));
+    u32(bits);
+  }
+  void op(opcode value) { u8(static_cast<U8>(value)); }
+  void samples(const std::vector<U8> &data) {
+    bytes.insert(bytes.end(), data.begin(), data.end());
+  }
+
+  void header(U32 tick_rate) {
+    bytes.insert(bytes.end(), std::begin(MAGIC), std::end(MAGIC));
+    op(opcode::version);
+    u16(VERSION);
+    op(opcode::tick_rate);
+    u32(tick_rate);
+  }
+  /// @brief Takes the finished dump, its version raised if it needs one
+  std::vector<U8> finish() {
+    if (extended) {
+      // Version follows the magic and its opcode
+      bytes[sizeof(MAGIC) + 1] = VERSION_EXTENDED & 0xFF;
+      bytes[sizeof(MAGIC) + 2] = VERSION_EXTENDED >> 8;
+    }
+    return std::move(bytes);
+  }
+  void patch(U8 id, const std::vector<U8> &data, U32 loop_start,
+             U32 loop_end, F32 pitch, F32 gain_L, F32 gain_R) {
+    op(opcode::patch);
+    u8(id);
+    u32(static_cast<U32>(data.size()));
+    u32(loop_start);
+    u32(loop_end);
+    f32(pitch);
+    f32(gain_L);
+    f32(gain_R);
+    samples(data);
+  }
+  void drum(U8 id, const std::vector<U8> &data, F32 pitch, F32 gain_L,
+            F32 gain_R) {
+    op(opcode::drum);
+    u8(id);
+    u32(static_cast<U32>(data.size()));
+    f32(pitch);
+    f32(gain_L);
+    f32(gain_R);
+    samples(data);
+  }
+  void encoded_patch(U8 id, U32 frames, U32 loop_start, U32 loop_end,
+                     F32 pitch, F32 gain_L, F32 gain_R, codec encoding,
+                     const std::vector<U8> &payload) {
+    extended = true;
+    op(opcode::encoded_patch);
+    u8(id);
+    u32(frames);
+    u32(loop_start);
+    u32(loop_end);
+    f32(pitch);
+    f32(gain_L);
+    f32(gain_R);
+    u8(static_cast<U8>(encoding));
+    u32(static_cast<U32>(payload.size()));
+    samples(payload);
+  }
+  void encoded_drum(U8 id, U32 frames, F32 pitch, F32 gain_L, F32 gain_R,
+                    codec encoding, const std::vector<U8> &payload) {
+    extended = true;
+    op(opcode::encoded_drum);
+    u8(id);
+    u32(frames);
+    f32(pitch);
+    f32(gain_L);
+    f32(gain_R);
+    u8(static_cast<U8>(encoding));
+    u32(static_cast<U32>(payload.size()));
+    samples(payload);
+  }
+  void note_on(U32 tick, U8 channel, U8 note, U8 velocity) {
+    op(opcode::note_on);
+    u32(tick);
+    u8(channel);
+    u8(note);
+    u8(velocity);
+  }
+  void note_off(U32 tick, U8 channel) {
+    op(opcode::note_off);
+    u32(tick);
+    u8(channel);
+  }
+  void note_off_keyed(U32 tick, U8 channel, U8 note) {
+    extended = true;
+    op(opcode::note_off_keyed);
+    u32(tick);
+    u8(channel);
+    u8(note);
+  }
+  void pitch_bend(U32 tick, U8 channel, S32 bend) {
+    op(opcode::pitch_bend);
+    u32(tick);
+    u8(channel);
+    s32(bend);
+  }
+  void program_change(U32 tick, U8 channel, U8 program) {
+    op(opcode::program_change);
+    u32(tick);
+    u8(channel);
+    u8(program);
+  }
+  void loop_start(U32 tick, U16 fraction) {
+    extended = true;
+    op(opcode::loop_start);
+    u32(tick);
+    u16(fraction);
+  }
+  void loop_end(U32 tick, U16 fraction) {
+    extended = true;
+    op(opcode::loop_end);
+    u32(tick);
+    u16(fraction);
+  }
+  void end_of_track(U32 tick) {
+    op(opcode::end_of_track);
+    u32(tick);
+  }
+};
+} // namespace axolotlsd::format
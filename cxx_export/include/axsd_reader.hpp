@@ -0,0 +1,320 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// AxolotlSD sequencer dump reader, decodes events once into a flat table
+#pragma once
+#include "axsd_format.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace axolotlsd::format {
+/// @brief One decoded event, fixed width and aligned so playback only has to
+/// advance an index
+struct alignas(4) event {
+  U32 tick;
+  opcode op;
+  U8 channel;
+  // Note for note on and keyed note off, program for program change
+  U8 note;
+  U8 velocity;
+  // Pitch bend amount
+  S32 bend;
+};
+static_assert(sizeof(event) == 12);
+
+/// @brief Events sharing one tick, dispatched together
+struct event_group {
+  U32 tick;
+  U32 first;
+  U32 count;
+};
+
+/// @brief A drum or patch, samples decoded whatever codec stored them
+struct bank_entry {
+  U8 id;
+  bool drum;
+  // Bytes per frame, 1 for unsigned 8-bit or 2 for signed 16-bit
+  U8 width;
+  U32 frames;
+  U32 loop_start;
+  U32 loop_end;
+  F32 pitch;
+  F32 gain_L;
+  F32 gain_R;
+  codec encoding;
+  // Bytes the samples took in the dump
+  U32 stored_bytes;
+  // Little-endian PCM, `frames` * `width` bytes
+  std::vector<U8> pcm;
+};
+
+/// @brief A whole dump, read once up front
+struct song_image {
+  U16 version = 0;
+  U32 tick_rate = TICK_RATE;
+  U32 end_tick = 0;
+  // Loop region in ticks, fractions in 1/65536ths, set when the dump has one
+  bool looping = false;
+  U32 loop_start_tick = 0;
+  U16 loop_start_fraction = 0;
+  U32 loop_end_tick = 0;
+  U16 loop_end_fraction = 0;
+  std::vector<bank_entry> bank;
+  // Sorted by tick, records on the same tick keep their order in the dump
+  std::vector<event> events;
+  std::vector<event_group> groups;
+  // Bytes the event records took in the dump
+  std::size_t event_stream_bytes = 0;
+
+  /// @brief Bytes the decoded event table and its groups occupy
+  std::size_t event_table_bytes() const {
+    return events.size() * sizeof(event) +
+           groups.size() * sizeof(event_group);
+  }
+  /// @brief Bytes the decoded samples occupy
+  std::size_t bank_bytes() const {
+    auto bytes = std::size_t{0};
+    for (const auto &entry : bank) {
+      bytes += entry.pcm.size();
+    }
+    return bytes;
+  }
+
+  /// @brief Parses a dump, throws std::runtime_error on malformed input
+  static song_image load(const std::vector<U8> &bytes);
+};
+
+namespace detail {
+struct reader {
+  const std::vector<U8> &bytes;
+  std::size_t position;
+
+  void need(std::size_t count) const {
+    if (bytes.size() - position < count) {
+      throw std::runtime_error{"AXSD dump ends unexpectedly at byte " +
+                               std::to_string(position)};
+    }
+  }
+  U8 u8() {
+    need(1);
+    return bytes[position++];
+  }
+  U16 u16() {
+    auto low = u8();
+    return static_cast<U16>(low | (u8() << 8));
+  }
+  U32 u32() {
+    auto low = u16();
+    return low | (static_cast<U32>(u16()) << 16);
+  }
+  S32 s32() { return static_cast<S32>(u32()); }
+  F32 f32() {
+    auto bits = u32();
+    auto value = F32{0};
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  const U8 *take(std::size_t count) {
+    need(count);
+    auto data = &bytes[position];
+    position += count;
+    return data;
+  }
+};
+
+inline std::vector<U8> decode_samples(const song_image &song,
+                                      bank_entry &entry, const U8 *payload,
+                                      std::size_t size) {
+  switch (entry.encoding) {
+  case codec::pcm_u8:
+  case codec::pcm_s16: {
+    entry.width = entry.encoding == codec::pcm_s16 ? 2 : 1;
+    if (size != std::size_t{entry.frames} * entry.width) {
+      throw std::runtime_error{"PCM payload does not match its frame count"};
+    }
+    return std::vector<U8>{payload, payload + size};
+  }
+  case codec::adpcm4: {
+    entry.width = 1;
+    return adpcm4_decode<U8>(payload, size, entry.frames);
+  }
+  case codec::adpcm4_s16: {
+    entry.width = 2;
+    auto pcm = std::vector<U8>{};
+    for (auto sample : adpcm4_decode<std::int16_t>(payload, size,
+                                                   entry.frames)) {
+      sample_format<std::int16_t>::write(pcm, sample);
+    }
+    return pcm;
+  }
+  case codec::reference: {
+    if (size != 2) {
+      throw std::runtime_error{"reference payload is not 2 bytes"};
+    }
+    auto drum = payload[0] == REFERENCE_DRUM;
+    for (const auto &earlier : song.bank) {
+      if (earlier.drum == drum && earlier.id == payload[1]) {
+        entry.width = earlier.width;
+        return earlier.pcm;
+      }
+    }
+    throw std::runtime_error{"reference to a sample not defined before it"};
+  }
+  default: {
+    throw std::runtime_error{"unknown sample codec"};
+  }
+  }
+}
+} // namespace detail
+
+inline song_image song_image::load(const std::vector<U8> &bytes) {
+  auto input = detail::reader{.bytes = bytes, .position = 0};
+  if (bytes.size() < sizeof(MAGIC) ||
+      std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error{"not an AXSD dump"};
+  }
+  input.position = sizeof(MAGIC);
+
+  auto song = song_image{};
+  auto ended = false;
+  while (!ended && input.position < bytes.size()) {
+    auto record_start = input.position;
+    auto events_before = song.events.size();
+    auto op = static_cast<opcode>(input.u8());
+    auto add_event = [&](U32 tick, U8 channel, U8 note, U8 velocity,
+                         S32 bend) {
+      song.events.emplace_back(event{.tick = tick,
+                                     .op = op,
+                                     .channel = channel,
+                                     .note = note,
+                                     .velocity = velocity,
+                                     .bend = bend});
+    };
+    switch (op) {
+    case opcode::version: {
+      song.version = input.u16();
+      if (song.version > VERSION_EXTENDED) {
+        throw std::runtime_error{"AXSD version " +
+                                 std::to_string(song.version) +
+                                 " is newer than this reader"};
+      }
+      break;
+    }
+    case opcode::tick_rate: {
+      song.tick_rate = input.u32();
+      break;
+    }
+    case opcode::patch:
+    case opcode::drum:
+    case opcode::encoded_patch:
+    case opcode::encoded_drum: {
+      auto drum = op == opcode::drum || op == opcode::encoded_drum;
+      auto entry = bank_entry{};
+      entry.drum = drum;
+      entry.id = input.u8();
+      entry.frames = input.u32();
+      if (!drum) {
+        entry.loop_start = input.u32();
+        entry.loop_end = input.u32();
+      }
+      entry.pitch = input.f32();
+      entry.gain_L = input.f32();
+      entry.gain_R = input.f32();
+      auto size = std::size_t{entry.frames};
+      entry.encoding = codec::pcm_u8;
+      if (op == opcode::encoded_patch || op == opcode::encoded_drum) {
+        entry.encoding = static_cast<codec>(input.u8());
+        size = input.u32();
+      }
+      entry.stored_bytes = static_cast<U32>(size);
+      auto payload = input.take(size);
+      entry.pcm = detail::decode_samples(song, entry, payload, size);
+      if (entry.pcm.size() != std::size_t{entry.frames} * entry.width) {
+        throw std::runtime_error{"sample payload at byte " +
+                                 std::to_string(record_start) +
+                                 " does not decode to its frame count"};
+      }
+      song.bank.emplace_back(std::move(entry));
+      break;
+    }
+    case opcode::note_on: {
+      auto tick = input.u32();
+      auto channel = input.u8();
+      auto note = input.u8();
+      add_event(tick, channel, note, input.u8(), 0);
+      break;
+    }
+    case opcode::note_off: {
+      auto tick = input.u32();
+      add_event(tick, input.u8(), 0, 0, 0);
+      break;
+    }
+    case opcode::note_off_keyed:
+    case opcode::program_change: {
+      auto tick = input.u32();
+      auto channel = input.u8();
+      add_event(tick, channel, input.u8(), 0, 0);
+      break;
+    }
+    case opcode::pitch_bend: {
+      auto tick = input.u32();
+      auto channel = input.u8();
+      add_event(tick, channel, 0, 0, input.s32());
+      break;
+    }
+    case opcode::loop_start: {
+      song.looping = true;
+      song.loop_start_tick = input.u32();
+      song.loop_start_fraction = input.u16();
+      break;
+    }
+    case opcode::loop_end: {
+      song.loop_end_tick = input.u32();
+      song.loop_end_fraction = input.u16();
+      break;
+    }
+    case opcode::end_of_track: {
+      song.end_tick = input.u32();
+      ended = true;
+      break;
+    }
+    default: {
+      throw std::runtime_error{"unknown record " +
+                               std::to_string(static_cast<int>(op)) +
+                               " at byte " + std::to_string(record_start)};
+    }
+    }
+    if (song.events.size() != events_before) {
+      song.event_stream_bytes += input.position - record_start;
+    }
+  }
+
+  // Tracks are written one after another, so the dump is not in tick order
+  std::stable_sort(
+      song.events.begin(), song.events.end(),
+      [](const event &a, const event &b) { return a.tick < b.tick; });
+  for (auto i = std::size_t{0}; i < song.events.size(); i++) {
+    auto tick = song.events[i].tick;
+    if (song.groups.empty() || song.groups.back().tick != tick) {
+      song.groups.emplace_back(event_group{
+          .tick = tick, .first = static_cast<U32>(i), .count = 0});
+    }
+    song.groups.back().count++;
+  }
+  return song;
+}
+} // namespace axolotlsd::format
@@ -0,0 +1,51 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Sample pack loader, a bank.json with drums/ and patches/ WAV directories
+#pragma once
+#include "axsd_format.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace axolotlsd::exporter {
+/// @brief One drum or patch, with its PCM frames already read
+struct sample {
+  format::U8 id;
+  std::string name;
+  // Bytes per frame, 1 for unsigned 8-bit or 2 for signed 16-bit
+  format::U8 width;
+  // Little-endian PCM as stored in the WAV
+  std::vector<format::U8> frames;
+  format::U32 loop_start;
+  format::U32 loop_end;
+  format::F32 pitch;
+  format::F32 gain_L;
+  format::F32 gain_R;
+
+  format::U32 frame_count() const {
+    return static_cast<format::U32>(frames.size() / width);
+  }
+};
+
+/// @brief Drums and patches in the order bank.json lists them
+struct bank {
+  std::vector<sample> drums;
+  std::vector<sample> patches;
+
+  /// @brief Reads `path`/bank.json and every WAV it names, throws on error
+  static bank load(const std::filesystem::path &path);
+};
+} // namespace axolotlsd::exporter
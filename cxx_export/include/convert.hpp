@@ -0,0 +1,48 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// MIDI to AxolotlSD sequencer dump conversion
+#pragma once
+#include "axsd_format.hpp"
+#include "bank.hpp"
+#include "midi.hpp"
+#include <string>
+#include <vector>
+
+namespace axolotlsd::exporter {
+// Samples ADPCM would decode noisier than this stay PCM, noise-like drums
+// such as hi-hats usually do
+constexpr static double ADPCM_MIN_SNR_DB = 35.0;
+
+/// @brief Bank encodings beyond what export.py writes, all off by default
+struct options {
+  // Samples identical to an earlier drum or patch become references
+  bool deduplicate = false;
+  // Samples are stored as 4-bit ADPCM, lossy but about half the size
+  bool adpcm = false;
+  // Note offs, and note ons with zero velocity, name the note they release
+  bool keyed_note_off = false;
+  // 16-bit WAVs are kept 16-bit, without this the pack is refused like
+  // export.py does since only encoded records can hold them
+  bool wide_samples = false;
+  // loopStart/loopEnd markers become loop region records
+  bool loop_points = false;
+};
+
+/// @brief Converts a MIDI file and sample bank into a sequencer dump
+/// @param log receives the same progress lines export.py prints
+std::vector<format::U8> convert(const midi::file &song, const bank &samples,
+                                const options &settings, std::string &log);
+} // namespace axolotlsd::exporter
@@ -0,0 +1,66 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Standard MIDI File reader, keeps every track and message like mido does
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace axolotlsd::midi {
+/// @brief A channel, system or meta message with its delta time in ticks
+struct message {
+  std::uint32_t delta;
+  // Status byte, 0xFF for meta messages
+  std::uint8_t status;
+  // Meta type for meta messages
+  std::uint8_t meta_type;
+  std::vector<std::uint8_t> data;
+
+  bool is_meta() const { return status == 0xFF; }
+  std::uint8_t kind() const { return status & 0xF0; }
+  std::uint8_t channel() const { return status & 0x0F; }
+};
+
+struct track {
+  std::vector<message> messages;
+};
+
+struct file {
+  std::uint16_t format;
+  std::uint16_t ticks_per_beat;
+  std::vector<track> tracks;
+
+  /// @brief Parses a Standard MIDI File, throws on malformed input
+  static file load(const std::vector<std::uint8_t> &bytes);
+};
+
+// Message kinds
+constexpr static std::uint8_t NOTE_OFF = 0x80;
+constexpr static std::uint8_t NOTE_ON = 0x90;
+constexpr static std::uint8_t PROGRAM_CHANGE = 0xC0;
+constexpr static std::uint8_t PITCHWHEEL = 0xE0;
+
+// Meta types
+constexpr static std::uint8_t META_MARKER = 0x06;
+constexpr static std::uint8_t META_END_OF_TRACK = 0x2F;
+constexpr static std::uint8_t META_SET_TEMPO = 0x51;
+
+/// @brief Same as mido.tick2second, kept bit-for-bit identical
+inline double tick2second(std::uint64_t tick, std::uint16_t ticks_per_beat,
+                          std::uint32_t tempo) {
+  auto scale = tempo * 1e-6 / ticks_per_beat;
+  return tick * scale;
+}
+} // namespace axolotlsd::midi
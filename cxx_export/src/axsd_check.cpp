@@ -0,0 +1,614 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Exporter checks, converts songs in-process and reads the dumps back
+#include "axsd_analysis.hpp"
+#include "axsd_reader.hpp"
+#include "configuration.hpp"
+#include "convert.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace axolotlsd;
+using namespace axolotlsd::format;
+
+// Funk's kick, snare and two longest patches encode well enough to keep
+constexpr static auto MIN_ADPCM_ENTRIES = 4;
+
+static std::vector<U8> read_file(const std::filesystem::path &path) {
+  auto reader = std::ifstream{path, std::ios::binary};
+  if (!reader) {
+    throw std::runtime_error{"could not open '" + path.string() + "'"};
+  }
+  return std::vector<U8>{std::istreambuf_iterator<char>{reader},
+                         std::istreambuf_iterator<char>{}};
+}
+
+// Converts `song` against `samples` and reads the dump straight back
+static song_image round_trip(const midi::file &song,
+                             const exporter::bank &samples,
+                             const exporter::options &settings,
+                             std::string &log) {
+  return song_image::load(exporter::convert(song, samples, settings, log));
+}
+static song_image round_trip(const std::filesystem::path &song,
+                             const exporter::bank &samples,
+                             const exporter::options &settings) {
+  auto log = std::string{};
+  return round_trip(midi::file::load(read_file(song)), samples, settings,
+                    log);
+}
+
+static const bank_entry *find_entry(const song_image &song, bool drum,
+                                    U8 id) {
+  for (const auto &entry : song.bank) {
+    if (entry.drum == drum && entry.id == id) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+// SNR of decoded samples against their source, in the 16-bit domain
+static double decoded_snr(const exporter::sample &source,
+                          const bank_entry &entry) {
+  if (source.width == 2) {
+    return snr_db(
+        unpack_pcm<std::int16_t>(source.frames.data(), source.frames.size()),
+        unpack_pcm<std::int16_t>(entry.pcm.data(), entry.pcm.size()));
+  }
+  return snr_db(unpack_pcm<U8>(source.frames.data(), source.frames.size()),
+                unpack_pcm<U8>(entry.pcm.data(), entry.pcm.size()));
+}
+
+using check = bool (*)(const std::filesystem::path &root);
+
+// Every ADPCM entry decodes close to its source, every other entry exactly
+static bool check_adpcm_snr(const std::filesystem::path &root) {
+  auto samples = exporter::bank::load(root / "sample_pack");
+  auto song = round_trip(root / "Funk.mid", samples,
+                         exporter::options{.adpcm = true});
+  auto ok = song.version == VERSION_EXTENDED;
+  if (!ok) {
+    std::fprintf(stderr, "encoded dump has version %u\n", song.version);
+  }
+  auto adpcm_entries = 0;
+  auto check_all = [&](const std::vector<exporter::sample> &entries,
+                       bool drum) {
+    for (const auto &source : entries) {
+      auto entry = find_entry(song, drum, source.id);
+      if (entry == nullptr) {
+        std::fprintf(stderr, "%s %u missing\n", drum ? "drum" : "patch",
+                     source.id);
+        ok = false;
+        continue;
+      }
+      auto snr = decoded_snr(source, *entry);
+      auto adpcm = entry->encoding == codec::adpcm4 ||
+                   entry->encoding == codec::adpcm4_s16;
+      adpcm_entries += adpcm ? 1 : 0;
+      auto passed =
+          entry->pcm.size() == source.frames.size() &&
+          (adpcm ? snr >= exporter::ADPCM_MIN_SNR_DB : entry->pcm ==
+                                                           source.frames);
+      std::fprintf(stderr, "%s %u: %s, %.1f dB%s\n", drum ? "drum" : "patch",
+                   source.id, adpcm ? "adpcm" : "pcm", snr,
+                   passed ? "" : " FAILED");
+      ok = ok && passed;
+    }
+  };
+  check_all(samples.drums, true);
+  check_all(samples.patches, false);
+  // Falling back to PCM everywhere would pass the SNR check trivially
+  if (adpcm_entries < MIN_ADPCM_ENTRIES) {
+    std::fprintf(stderr, "only %d entries encoded\n", adpcm_entries);
+    ok = false;
+  }
+  return ok;
+}
+
+// References decode byte-identical to the entry they point at, and only
+// point at entries stored the way the referencing entry would be
+static bool check_dedup_identical(const std::filesystem::path &root) {
+  auto samples = exporter::bank::load(root / "sample_pack");
+  // The pack has no duplicates of its own, so add some: straight copies of a
+  // drum and a patch, and a short snippet used both as a drum ADPCM suits and
+  // as a single-cycle looping patch it does not
+  auto copy = samples.drums.front();
+  copy.id = 0x7F;
+  copy.name = "copy of drum " + samples.drums.front().name;
+  samples.drums.emplace_back(copy);
+  copy = samples.patches.front();
+  copy.id = 0x7F;
+  copy.name = "copy of patch " + samples.patches.front().name;
+  samples.patches.emplace_back(copy);
+  constexpr auto snippet_frames = 800;
+  copy = samples.drums.front();
+  copy.id = 0x7E;
+  copy.name = "snippet drum";
+  copy.frames.resize(snippet_frames);
+  samples.drums.emplace_back(copy);
+  copy.name = "snippet patch";
+  copy.loop_start = 0;
+  copy.loop_end = snippet_frames - 1;
+  samples.patches.emplace_back(copy);
+
+  auto ok = true;
+  for (auto adpcm : {false, true}) {
+    auto song = round_trip(
+        root / "Funk.mid", samples,
+        exporter::options{.deduplicate = true, .adpcm = adpcm});
+    auto references = 0;
+    auto check_all = [&](const std::vector<exporter::sample> &entries,
+                         bool drum) {
+      for (const auto &source : entries) {
+        auto entry = find_entry(song, drum, source.id);
+        if (entry == nullptr) {
+          std::fprintf(stderr, "%s %u missing\n", drum ? "drum" : "patch",
+                       source.id);
+          ok = false;
+          continue;
+        }
+        auto passed = entry->width == source.width &&
+                      entry->pcm.size() == source.frames.size();
+        if (entry->encoding == codec::reference) {
+          references++;
+        } else if (entry->encoding == codec::adpcm4) {
+          passed = passed &&
+                   decoded_snr(source, *entry) >= exporter::ADPCM_MIN_SNR_DB;
+        } else {
+          passed = passed && entry->pcm == source.frames;
+        }
+        if (!passed) {
+          std::fprintf(stderr, "%s %u does not decode to its source\n",
+                       drum ? "drum" : "patch", source.id);
+          ok = false;
+        }
+      }
+    };
+    check_all(samples.drums, true);
+    check_all(samples.patches, false);
+
+    // A reference decodes to exactly what it points at
+    for (const auto &entry : song.bank) {
+      if (entry.encoding != codec::reference) {
+        continue;
+      }
+      auto source = &entry;
+      for (const auto &earlier : song.bank) {
+        if (&earlier != &entry && earlier.pcm == entry.pcm &&
+            earlier.encoding != codec::reference) {
+          source = &earlier;
+          break;
+        }
+      }
+      if (source == &entry) {
+        std::fprintf(stderr, "%s %u references nothing identical\n",
+                     entry.drum ? "drum" : "patch", entry.id);
+        ok = false;
+      }
+    }
+
+    // With ADPCM the snippet patch stays PCM instead of taking the drum's
+    // lossy samples
+    auto snippet = find_entry(song, false, 0x7E);
+    auto expected = adpcm ? 2 : 3;
+    if (adpcm && (snippet == nullptr || snippet->encoding != codec::pcm_u8 ||
+                  find_entry(song, true, 0x7E)->encoding != codec::adpcm4)) {
+      std::fprintf(stderr, "snippet patch referenced the ADPCM drum\n");
+      ok = false;
+    }
+    std::fprintf(stderr, "%s: %d references, expected %d\n",
+                 adpcm ? "--dedup --adpcm" : "--dedup", references, expected);
+    ok = ok && references == expected;
+  }
+  return ok;
+}
+
+// A pack of 16-bit WAVs is refused unless asked for, and comes back 16-bit
+static bool check_s16_round_trip(const std::filesystem::path &root) {
+  auto samples =
+      exporter::bank::load(root / "cxx_export" / "fixtures" / "pack_s16");
+  auto song_path = root / "Funk.mid";
+  try {
+    round_trip(song_path, samples, exporter::options{});
+    std::fprintf(stderr, "16-bit pack exported without --16bit\n");
+    return false;
+  } catch (const std::runtime_error &error) {
+    std::fprintf(stderr, "refused: %s\n", error.what());
+  }
+
+  auto ok = true;
+  for (auto adpcm : {false, true}) {
+    auto song = round_trip(
+        song_path, samples,
+        exporter::options{.adpcm = adpcm, .wide_samples = true});
+    if (song.version != VERSION_EXTENDED) {
+      std::fprintf(stderr, "16-bit dump has version %u\n", song.version);
+      ok = false;
+    }
+    auto check_all = [&](const std::vector<exporter::sample> &entries,
+                         bool drum) {
+      for (const auto &source : entries) {
+        auto entry = find_entry(song, drum, source.id);
+        if (entry == nullptr) {
+          std::fprintf(stderr, "%s %u missing\n", drum ? "drum" : "patch",
+                       source.id);
+          ok = false;
+          continue;
+        }
+        auto expected = adpcm ? codec::adpcm4_s16 : codec::pcm_s16;
+        auto snr = decoded_snr(source, *entry);
+        auto passed = entry->width == 2 && entry->encoding == expected &&
+                      entry->frames == source.frame_count() &&
+                      entry->pcm.size() == source.frames.size() &&
+                      (adpcm ? snr >= exporter::ADPCM_MIN_SNR_DB
+                             : entry->pcm == source.frames);
+        std::fprintf(stderr, "%s %u: %s, %.1f dB%s\n",
+                     drum ? "drum" : "patch", source.id,
+                     adpcm ? "adpcm4_s16" : "pcm_s16", snr,
+                     passed ? "" : " FAILED");
+        ok = ok && passed;
+      }
+    };
+    check_all(samples.drums, true);
+    check_all(samples.patches, false);
+  }
+  return ok;
+}
+
+static std::vector<U8> to_bytes(const char *text) {
+  return std::vector<U8>{text, text + std::strlen(text)};
+}
+
+static bool is_marker(const midi::message &message, const char *text) {
+  return message.is_meta() && message.meta_type == midi::META_MARKER &&
+         message.data == to_bytes(text);
+}
+
+// Loop markers in fixtures/loop.mid, 120 BPM at 480 ticks per beat: start
+// at MIDI tick 100 (6.25 sequencer ticks), end at 1000 (62.5), song end at
+// 1920 (120)
+static bool check_loop_markers(const std::filesystem::path &root) {
+  auto samples = exporter::bank::load(root / "sample_pack");
+  auto song = midi::file::load(
+      read_file(root / "cxx_export" / "fixtures" / "loop.mid"));
+  auto settings = exporter::options{.loop_points = true};
+  auto ok = true;
+  auto expect = [&](const char *what, const song_image &image, bool looping,
+                    U32 start, U16 start_fraction, U32 end,
+                    U16 end_fraction) {
+    auto passed = image.looping == looping && image.end_tick == 120 &&
+                  (!looping || (image.loop_start_tick == start &&
+                                image.loop_start_fraction == start_fraction &&
+                                image.loop_end_tick == end &&
+                                image.loop_end_fraction == end_fraction));
+    std::fprintf(stderr, "%s: %s %u+%u to %u+%u, version %u%s\n", what,
+                 image.looping ? "loops" : "no loop", image.loop_start_tick,
+                 image.loop_start_fraction, image.loop_end_tick,
+                 image.loop_end_fraction, image.version,
+                 passed ? "" : " FAILED");
+    ok = ok && passed;
+  };
+
+  // Off by default, the dump stays one the current player loads
+  auto log = std::string{};
+  auto plain = round_trip(song, samples, exporter::options{}, log);
+  expect("without --loop", plain, false, 0, 0, 0, 0);
+  ok = ok && plain.version == VERSION;
+
+  log.clear();
+  expect("both markers", round_trip(song, samples, settings, log), true, 6,
+         16384, 62, 32768);
+
+  // Markers are matched in any case, and the loop defaults to the song end
+  auto without_end = song;
+  auto &messages = without_end.tracks.front().messages;
+  for (auto i = std::size_t{0}; i < messages.size(); i++) {
+    if (is_marker(messages[i], "loopEnd")) {
+      messages[i + 1].delta += messages[i].delta;
+      messages.erase(messages.begin() + i);
+      break;
+    }
+  }
+  for (auto &message : messages) {
+    if (is_marker(message, "loopStart")) {
+      message.data = to_bytes("LOOPSTART");
+    }
+  }
+  log.clear();
+  expect("no loop end", round_trip(without_end, samples, settings, log), true,
+         6, 16384, 120, 0);
+
+  // An end before the start is dropped with a warning
+  auto reversed = song;
+  for (auto &message : reversed.tracks.front().messages) {
+    if (is_marker(message, "loopStart")) {
+      message.data = to_bytes("loopEnd");
+    } else if (is_marker(message, "loopEnd")) {
+      message.data = to_bytes("loopStart");
+    }
+  }
+  log.clear();
+  expect("end before start", round_trip(reversed, samples, settings, log),
+         false, 0, 0, 0, 0);
+  if (log.find("warning: loop end") == std::string::npos) {
+    std::fprintf(stderr, "no warning for the reversed loop\n");
+    ok = false;
+  }
+  return ok;
+}
+
+// Voice counting on a crafted dump at 44100 Hz and 60 ticks per second:
+// - tick 0: a looping patch is played three times on the same note, a
+//   non-looping patch that lasts 0.5 s, a drum that lasts 0.1 s, and a drum
+//   missing from the bank, 5 voices in all
+// - tick 60: a keyed note off releases one of the retriggered notes
+// - tick 120: a note off releases the other two
+// - tick 240: the song ends, 3 + 2 + 0.5 + 0.1 voice seconds over 4 s
+static bool check_analysis(const std::filesystem::path &) {
+  auto silence = [](std::size_t frames) {
+    return std::vector<U8>(frames, 0x80);
+  };
+  auto dump = writer{};
+  dump.header(TICK_RATE);
+  dump.drum(36, silence(4410), 1.0f, 1.0f, 1.0f);
+  dump.patch(1, silence(100), 0, 99, 1.0f, 1.0f, 1.0f);
+  dump.patch(2, silence(22050), NO_LOOP, NO_LOOP, 1.0f, 1.0f, 1.0f);
+  dump.program_change(0, 0, 1);
+  dump.program_change(0, 1, 2);
+  dump.note_on(0, 0, 60, 100);
+  dump.note_on(0, 0, 60, 100);
+  dump.note_on(0, 0, 60, 100);
+  dump.note_on(0, 1, 64, 100);
+  dump.note_on(0, DRUM_CHANNEL, 36, 100);
+  dump.note_on(0, DRUM_CHANNEL, 37, 100);
+  dump.note_off_keyed(60, 0, 60);
+  dump.note_off(120, 0);
+  dump.end_of_track(240);
+
+  auto analysis = analyze(song_image::load(dump.finish()), 44100);
+  std::fprintf(stderr, "peak %u, mean %.4f, %.4f s\n", analysis.peak_voices,
+               analysis.mean_voices, analysis.duration_seconds);
+  return analysis.peak_voices == 5 &&
+         std::fabs(analysis.mean_voices - 5.6 / 4.0) < 1.0e-9 &&
+         analysis.duration_seconds == 4.0;
+}
+
+// Zero and SMPTE divisions would give infinite or meaningless tick times
+static bool check_midi_division(const std::filesystem::path &) {
+  auto ok = true;
+  for (auto division : {0x0000, 0xE728}) {
+    auto header = std::vector<U8>{'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 0,
+                                  static_cast<U8>(division >> 8),
+                                  static_cast<U8>(division & 0xFF)};
+    try {
+      midi::file::load(header);
+      std::fprintf(stderr, "division %04x accepted\n", division);
+      ok = false;
+    } catch (const std::runtime_error &error) {
+      std::fprintf(stderr, "division %04x refused: %s\n", division,
+                   error.what());
+    }
+  }
+  return ok;
+}
+
+// With keyed note offs every MIDI note off, and every zero velocity note on,
+// becomes an 0x05 record naming its channel and note, and no 0x02 or zero
+// velocity 0x01 record is left
+static bool check_keyed_note_off(const std::filesystem::path &root) {
+  auto samples = exporter::bank::load(root / "sample_pack");
+  auto funk = midi::file::load(read_file(root / "Funk.mid"));
+  // Funk only uses note offs, so also try it with zero velocity note ons
+  auto silent_ons = funk;
+  for (auto &track : silent_ons.tracks) {
+    for (auto &message : track.messages) {
+      if (!message.is_meta() && message.status < 0xF0 &&
+          message.kind() == midi::NOTE_OFF) {
+        message.status = midi::NOTE_ON | message.channel();
+        message.data[1] = 0;
+      }
+    }
+  }
+
+  auto ok = true;
+  for (const auto *song : {&funk, &silent_ons}) {
+    auto expected = std::map<std::pair<U8, U8>, int>{};
+    auto note_offs = 0;
+    auto zero_velocity = 0;
+    for (const auto &track : song->tracks) {
+      for (const auto &message : track.messages) {
+        if (message.is_meta() || message.status >= 0xF0) {
+          continue;
+        }
+        auto off = message.kind() == midi::NOTE_OFF;
+        auto silent =
+            message.kind() == midi::NOTE_ON && message.data[1] == 0;
+        note_offs += off ? 1 : 0;
+        zero_velocity += silent ? 1 : 0;
+        if (off || silent) {
+          expected[{message.channel(), message.data[0]}]++;
+        }
+      }
+    }
+
+    auto log = std::string{};
+    auto image = round_trip(*song, samples,
+                            exporter::options{.keyed_note_off = true}, log);
+    auto written = std::map<std::pair<U8, U8>, int>{};
+    for (const auto &ev : image.events) {
+      if (ev.op == opcode::note_off_keyed) {
+        written[{ev.channel, ev.note}]++;
+      } else if (ev.op == opcode::note_off) {
+        std::fprintf(stderr, "channel note off left at tick %u\n", ev.tick);
+        ok = false;
+      } else if (ev.op == opcode::note_on && ev.velocity == 0) {
+        std::fprintf(stderr, "zero velocity note on left at tick %u\n",
+                     ev.tick);
+        ok = false;
+      }
+    }
+    auto matched = written == expected && note_offs + zero_velocity > 0;
+    std::fprintf(stderr,
+                 "%d note offs and %d zero velocity note ons over %zu keys%s\n",
+                 note_offs, zero_velocity, expected.size(),
+                 matched ? "" : ", keyed note offs do not match");
+    ok = ok && matched;
+  }
+  return ok;
+}
+
+// The reader sorts events of tracks written one after another into tick
+// order, keeps records on the same tick in dump order, and groups each tick
+static bool check_event_table(const std::filesystem::path &) {
+  auto dump = writer{};
+  dump.header(TICK_RATE);
+  dump.drum(36, std::vector<U8>(16, 0x80), 1.0f, 1.0f, 1.0f);
+  auto stream_bytes = std::size_t{0};
+  // Each record carries its position in the dump as its note or bend, the
+  // channel note off is record 7
+  auto record = [&](auto write) {
+    auto before = dump.bytes.size();
+    write();
+    stream_bytes += dump.bytes.size() - before;
+  };
+  // First track
+  record([&] { dump.program_change(0, 0, 0); });
+  record([&] { dump.note_on(0, 0, 1, 100); });
+  record([&] { dump.note_off_keyed(30, 0, 2); });
+  record([&] { dump.note_on(60, 0, 3, 100); });
+  // Second track, starting over from tick 0
+  record([&] { dump.note_on(0, 1, 4, 100); });
+  record([&] { dump.pitch_bend(15, 1, 5); });
+  record([&] { dump.note_on(30, 1, 6, 100); });
+  record([&] { dump.note_off(90, 1); });
+  // Third track, on a tick the others use and one of its own
+  record([&] { dump.note_on(30, 2, 8, 100); });
+  record([&] { dump.note_on(45, 2, 9, 100); });
+  dump.end_of_track(120);
+
+  auto song = song_image::load(dump.finish());
+  // Record positions by tick, dump order within a tick
+  auto expected_order = std::vector<int>{0, 1, 4, 5, 2, 6, 8, 9, 3, 7};
+  auto order = std::vector<int>{};
+  for (const auto &ev : song.events) {
+    switch (ev.op) {
+    case opcode::pitch_bend: {
+      order.emplace_back(ev.bend);
+      break;
+    }
+    case opcode::note_off: {
+      order.emplace_back(7);
+      break;
+    }
+    default: {
+      order.emplace_back(ev.note);
+      break;
+    }
+    }
+  }
+  auto ok = order == expected_order;
+  if (!ok) {
+    std::fprintf(stderr, "events are not in tick then dump order\n");
+  }
+  for (auto i = std::size_t{1}; i < song.events.size(); i++) {
+    if (song.events[i].tick < song.events[i - 1].tick) {
+      std::fprintf(stderr, "event %zu goes back in time\n", i);
+      ok = false;
+    }
+  }
+
+  // Groups cover every event once, in order, one per distinct tick
+  auto next = U32{0};
+  for (auto i = std::size_t{0}; i < song.groups.size(); i++) {
+    const auto &group = song.groups[i];
+    auto exact = group.first == next && group.count > 0 &&
+                 (i == 0 || song.groups[i - 1].tick < group.tick);
+    for (auto j = group.first; exact && j < group.first + group.count; j++) {
+      exact = j < song.events.size() && song.events[j].tick == group.tick;
+    }
+    if (!exact) {
+      std::fprintf(stderr, "group %zu at tick %u is wrong\n", i, group.tick);
+      ok = false;
+    }
+    next = group.first + group.count;
+  }
+  if (next != song.events.size() || song.groups.size() != 6) {
+    std::fprintf(stderr, "%zu groups cover %u of %zu events\n",
+                 song.groups.size(), next, song.events.size());
+    ok = false;
+  }
+
+  if (song.event_stream_bytes != stream_bytes) {
+    std::fprintf(stderr, "event stream %zu bytes, written %zu\n",
+                 song.event_stream_bytes, stream_bytes);
+    ok = false;
+  }
+  std::fprintf(stderr, "%zu events in %zu groups, %zu stream bytes\n",
+               song.events.size(), song.groups.size(),
+               song.event_stream_bytes);
+  return ok;
+}
+
+struct named_check {
+  const char *name;
+  check run;
+};
+
+constexpr static named_check CHECKS[] = {
+    {"adpcm_snr", check_adpcm_snr},
+    {"dedup_identical", check_dedup_identical},
+    {"s16_round_trip", check_s16_round_trip},
+    {"loop_markers", check_loop_markers},
+    {"analysis", check_analysis},
+    {"midi_division", check_midi_division},
+    {"keyed_note_off", check_keyed_note_off},
+    {"event_table", check_event_table},
+};
+
+int main(int argc, char **argv) {
+  std::fprintf(stderr,
+               "AxolotlSD C++ exporter checks " axolotlsd_export_VSTRING_FULL
+               "\n");
+  if (argc != 3) {
+    std::fprintf(stderr, "Usage: %s <repository root> <check>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (const auto &named : CHECKS) {
+    if (std::strcmp(named.name, argv[2]) != 0) {
+      continue;
+    }
+    try {
+      return named.run(argv[1]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (const std::exception &error) {
+      std::fprintf(stderr, "%s: %s\n", named.name, error.what());
+      return EXIT_FAILURE;
+    }
+  }
+  std::fprintf(stderr, "Unknown check '%s'\n", argv[2]);
+  return EXIT_FAILURE;
+}
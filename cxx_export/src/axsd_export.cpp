@@ -0,0 +1,162 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Exporter program file, converts MIDI files to AxolotlSD dumps
+#include "configuration.hpp"
+#include "convert.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct job {
+  const char *input;
+  const char *output;
+};
+
+static std::vector<axolotlsd::format::U8> read_file(const char *path) {
+  auto reader = std::ifstream{path, std::ios::binary};
+  if (!reader) {
+    throw std::runtime_error{"could not open '" + std::string{path} + "'"};
+  }
+  return std::vector<axolotlsd::format::U8>{
+      std::istreambuf_iterator<char>{reader}, std::istreambuf_iterator<char>{}};
+}
+
+static void write_file(const char *path,
+                       const std::vector<axolotlsd::format::U8> &bytes) {
+  auto writer = std::fopen(path, "wb");
+  if (writer == nullptr) {
+    throw std::runtime_error{"could not write '" + std::string{path} + "'"};
+  }
+  auto written = std::fwrite(bytes.data(), 1, bytes.size(), writer);
+  std::fclose(writer);
+  if (written != bytes.size()) {
+    throw std::runtime_error{"short write to '" + std::string{path} + "'"};
+  }
+}
+
+static void usage(const char *self) {
+  std::fprintf(stderr,
+               "Usage: %s [options] <input.mid> <output.axsd> <sample pack>\n",
+               self);
+  std::fprintf(stderr,
+               "       %s [options] -j <jobs> <sample pack> <input.mid> "
+               "<output.axsd> [<input.mid> <output.axsd> ...]\n",
+               self);
+  std::fprintf(stderr, "Options:\n");
+  std::fprintf(stderr, "  --dedup  reference identical samples once\n");
+  std::fprintf(stderr, "  --adpcm  store samples as 4-bit ADPCM\n");
+  std::fprintf(stderr, "  --keyed  note offs release a single note\n");
+  std::fprintf(stderr, "  --16bit  keep 16-bit samples 16-bit\n");
+  std::fprintf(stderr, "  --loop   write loopStart/loopEnd markers\n");
+}
+
+int main(int argc, char **argv) {
+  std::fprintf(stderr,
+               "AxolotlSD C++ exporter " axolotlsd_export_VSTRING_FULL "\n");
+
+  auto settings = axolotlsd::exporter::options{};
+  auto first = 1;
+  for (; first < argc && std::strncmp(argv[first], "--", 2) == 0; first++) {
+    if (std::strcmp(argv[first], "--dedup") == 0) {
+      settings.deduplicate = true;
+    } else if (std::strcmp(argv[first], "--adpcm") == 0) {
+      settings.adpcm = true;
+    } else if (std::strcmp(argv[first], "--keyed") == 0) {
+      settings.keyed_note_off = true;
+    } else if (std::strcmp(argv[first], "--16bit") == 0) {
+      settings.wide_samples = true;
+    } else if (std::strcmp(argv[first], "--loop") == 0) {
+      settings.loop_points = true;
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  auto remaining = argc - first;
+  auto args = argv + first;
+
+  auto jobs = std::vector<job>{};
+  auto threads = 1u;
+  const char *sample_pack = nullptr;
+  if (remaining == 3 && std::strcmp(args[0], "-j") != 0) {
+    jobs.emplace_back(job{.input = args[0], .output = args[1]});
+    sample_pack = args[2];
+  } else if (remaining >= 5 && std::strcmp(args[0], "-j") == 0 &&
+             (remaining - 3) % 2 == 0) {
+    threads = static_cast<unsigned>(std::strtoul(args[1], nullptr, 10));
+    if (threads == 0) {
+      threads = std::thread::hardware_concurrency();
+    }
+    sample_pack = args[2];
+    for (auto i = 3; i < remaining; i += 2) {
+      jobs.emplace_back(job{.input = args[i], .output = args[i + 1]});
+    }
+  } else {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // The bank is read once and shared read-only by every conversion
+  auto samples = axolotlsd::exporter::bank{};
+  try {
+    samples = axolotlsd::exporter::bank::load(sample_pack);
+  } catch (const std::exception &error) {
+    std::fprintf(stderr, "%s\n", error.what());
+    return EXIT_FAILURE;
+  }
+
+  auto next = std::atomic<std::size_t>{0};
+  auto failures = std::atomic<std::size_t>{0};
+  auto print_lock = std::mutex{};
+  auto worker = [&]() {
+    for (auto i = next++; i < jobs.size(); i = next++) {
+      auto log = std::string{};
+      try {
+        auto song = axolotlsd::midi::file::load(read_file(jobs[i].input));
+        write_file(jobs[i].output,
+                   axolotlsd::exporter::convert(song, samples, settings, log));
+      } catch (const std::exception &error) {
+        log += std::string{jobs[i].input} + ": " + error.what() + "\n";
+        failures++;
+      }
+      auto guard = std::lock_guard{print_lock};
+      if (jobs.size() > 1) {
+        std::fprintf(stdout, "== %s -> %s\n", jobs[i].input, jobs[i].output);
+      }
+      std::fputs(log.c_str(), stdout);
+    }
+  };
+
+  auto pool = std::vector<std::thread>{};
+  for (auto i = 1u; i < threads && i < jobs.size(); i++) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+
+  return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Inspector program file, decodes AxolotlSD dumps and reports their cost
+#include "axsd_analysis.hpp"
+#include "axsd_reader.hpp"
+#include "configuration.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace axolotlsd::format;
+
+// Sample rate the cost estimate assumes unless --rate says otherwise
+constexpr static U32 DEFAULT_SAMPLE_RATE = 44100;
+
+static void report(const char *path, const std::vector<U8> &bytes,
+                   const song_image &song, U32 sample_rate) {
+  std::fprintf(stdout, "%s: %zu bytes, version %u\n", path, bytes.size(),
+               song.version);
+  std::fprintf(stdout, "  tick rate %u, ends at tick %u\n", song.tick_rate,
+               song.end_tick);
+  if (song.looping) {
+    std::fprintf(stdout, "  loops from tick %u+%u/65536 to %u+%u/65536\n",
+                 song.loop_start_tick, song.loop_start_fraction,
+                 song.loop_end_tick, song.loop_end_fraction);
+  }
+
+  auto stored = std::size_t{0};
+  for (const auto &entry : song.bank) {
+    stored += entry.stored_bytes;
+  }
+  std::fprintf(stdout, "  bank: %zu entries, %zu bytes stored, %zu decoded\n",
+               song.bank.size(), stored, song.bank_bytes());
+
+  std::fprintf(stdout, "  events: %zu in %zu ticks\n", song.events.size(),
+               song.groups.size());
+  std::fprintf(stdout,
+               "  event stream %zu bytes, decoded table %zu bytes "
+               "(%zu events + %zu groups)\n",
+               song.event_stream_bytes, song.event_table_bytes(),
+               song.events.size() * sizeof(event),
+               song.groups.size() * sizeof(event_group));
+
+  auto analysis = analyze(song, sample_rate);
+  std::fprintf(stdout, "  duration %.3f s, %.1f events/s\n",
+               analysis.duration_seconds, analysis.events_per_second);
+  std::fprintf(stdout, "  voices: peak %u, mean %.2f\n", analysis.peak_voices,
+               analysis.mean_voices);
+  std::fprintf(stdout, "  mixing at %u Hz: %.0f voice frames/s\n",
+               sample_rate, analysis.voice_frames_per_second);
+}
+
+int main(int argc, char **argv) {
+  std::fprintf(stderr,
+               "AxolotlSD C++ inspector " axolotlsd_export_VSTRING_FULL "\n");
+
+  auto sample_rate = DEFAULT_SAMPLE_RATE;
+  auto first = 1;
+  if (argc > 3 && std::strcmp(argv[1], "--rate") == 0) {
+    sample_rate = static_cast<U32>(std::strtoul(argv[2], nullptr, 10));
+    first = 3;
+  }
+  if (argc <= first || sample_rate == 0) {
+    std::fprintf(stderr,
+                 "Usage: %s [--rate <hz>] <song.axsd> [<song.axsd> ...]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto failures = 0;
+  for (auto i = first; i < argc; i++) {
+    auto reader = std::ifstream{argv[i], std::ios::binary};
+    if (!reader) {
+      std::fprintf(stderr, "could not open '%s'\n", argv[i]);
+      failures++;
+      continue;
+    }
+    auto bytes = std::vector<U8>{std::istreambuf_iterator<char>{reader},
+                                 std::istreambuf_iterator<char>{}};
+    try {
+      report(argv[i], bytes, song_image::load(bytes), sample_rate);
+    } catch (const std::exception &error) {
+      std::fprintf(stderr, "%s: %s\n", argv[i], error.what());
+      failures++;
+    }
+  }
+  return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
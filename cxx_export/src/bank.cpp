@@ -0,0 +1,332 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Sample pack loader
+#include "bank.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+using namespace axolotlsd::exporter;
+using namespace axolotlsd::format;
+
+namespace {
+std::vector<U8> read_file(const std::filesystem::path &path) {
+  auto reader = std::ifstream{path, std::ios::binary};
+  if (!reader) {
+    throw std::runtime_error{"could not open '" + path.string() + "'"};
+  }
+  return std::vector<U8>{std::istreambuf_iterator<char>{reader},
+                         std::istreambuf_iterator<char>{}};
+}
+
+// ============================================================================
+// JSON, just enough for bank.json, objects keep their key order
+// ============================================================================
+struct json {
+  enum class type { null, boolean, number, string, array, object };
+  type kind = type::null;
+  double number = 0.0;
+  std::string string;
+  std::vector<json> array;
+  std::vector<std::pair<std::string, json>> object;
+
+  const json &operator[](const std::string &key) const {
+    for (const auto &[name, value] : object) {
+      if (name == key) {
+        return value;
+      }
+    }
+    throw std::runtime_error{"bank.json is missing '" + key + "'"};
+  }
+  const json &operator[](std::size_t index) const {
+    if (kind != type::array || index >= array.size()) {
+      throw std::runtime_error{"bank.json array is too short"};
+    }
+    return array[index];
+  }
+  double as_number() const {
+    if (kind != type::number) {
+      throw std::runtime_error{"bank.json value is not a number"};
+    }
+    return number;
+  }
+};
+
+struct json_parser {
+  const std::vector<U8> &text;
+  std::size_t position;
+
+  [[noreturn]] void fail(const char *what) {
+    throw std::runtime_error{"bank.json: " + std::string{what} + " at byte " +
+                             std::to_string(position)};
+  }
+  void skip_space() {
+    while (position < text.size() && std::isspace(text[position])) {
+      position++;
+    }
+  }
+  char peek() {
+    skip_space();
+    if (position >= text.size()) {
+      fail("unexpected end");
+    }
+    return static_cast<char>(text[position]);
+  }
+  void expect(char ch) {
+    if (peek() != ch) {
+      fail("unexpected character");
+    }
+    position++;
+  }
+
+  std::string parse_string() {
+    expect('"');
+    auto result = std::string{};
+    while (true) {
+      if (position >= text.size()) {
+        fail("unterminated string");
+      }
+      auto ch = static_cast<char>(text[position++]);
+      if (ch == '"') {
+        return result;
+      }
+      if (ch == '\\') {
+        if (position >= text.size()) {
+          fail("unterminated string");
+        }
+        ch = static_cast<char>(text[position++]);
+        switch (ch) {
+        case 'n':
+          ch = '\n';
+          break;
+        case 't':
+          ch = '\t';
+          break;
+        case 'r':
+          ch = '\r';
+          break;
+        case 'b':
+          ch = '\b';
+          break;
+        case 'f':
+          ch = '\f';
+          break;
+        case 'u':
+          fail("unicode escapes are not supported");
+        default:
+          break;
+        }
+      }
+      result += ch;
+    }
+  }
+
+  json parse_value() {
+    auto result = json{};
+    auto ch = peek();
+    if (ch == '{') {
+      result.kind = json::type::object;
+      position++;
+      if (peek() == '}') {
+        position++;
+        return result;
+      }
+      while (true) {
+        auto key = parse_string();
+        expect(':');
+        result.object.emplace_back(std::move(key), parse_value());
+        if (peek() == ',') {
+          position++;
+          continue;
+        }
+        expect('}');
+        return result;
+      }
+    }
+    if (ch == '[') {
+      result.kind = json::type::array;
+      position++;
+      if (peek() == ']') {
+        position++;
+        return result;
+      }
+      while (true) {
+        result.array.emplace_back(parse_value());
+        if (peek() == ',') {
+          position++;
+          continue;
+        }
+        expect(']');
+        return result;
+      }
+    }
+    if (ch == '"') {
+      result.kind = json::type::string;
+      result.string = parse_string();
+      return result;
+    }
+    for (auto [word, kind, truth] :
+         {std::tuple{"true", json::type::boolean, 1.0},
+          std::tuple{"false", json::type::boolean, 0.0},
+          std::tuple{"null", json::type::null, 0.0}}) {
+      auto length = std::strlen(word);
+      if (text.size() - position >= length &&
+          std::memcmp(&text[position], word, length) == 0) {
+        position += length;
+        result.kind = kind;
+        result.number = truth;
+        return result;
+      }
+    }
+    auto begin = position;
+    while (position < text.size() &&
+           std::strchr("+-0123456789.eE", text[position]) != nullptr &&
+           text[position] != '\0') {
+      position++;
+    }
+    if (begin == position) {
+      fail("unexpected character");
+    }
+    result.kind = json::type::number;
+    result.number = std::strtod(
+        std::string{text.begin() + begin, text.begin() + position}.c_str(),
+        nullptr);
+    return result;
+  }
+};
+
+// ============================================================================
+// WAV, mono 8-bit or 16-bit PCM
+// ============================================================================
+std::uint32_t le(const std::vector<U8> &bytes, std::size_t at, int width) {
+  auto value = std::uint32_t{0};
+  for (auto i = width - 1; i >= 0; i--) {
+    value = (value << 8) | bytes[at + i];
+  }
+  return value;
+}
+
+std::vector<U8> read_wave(const std::filesystem::path &path, const char *what,
+                          U8 &width) {
+  auto bytes = read_file(path);
+  auto name = path.filename().string();
+  if (bytes.size() < 12 || std::memcmp(&bytes[0], "RIFF", 4) != 0 ||
+      std::memcmp(&bytes[8], "WAVE", 4) != 0) {
+    throw std::runtime_error{"'" + name + "' is not a WAVE file"};
+  }
+  auto channels = 0u;
+  auto sample_width = 0u;
+  auto have_format = false;
+  auto position = std::size_t{12};
+  while (position + 8 <= bytes.size()) {
+    auto chunk_size = le(bytes, position + 4, 4);
+    auto data = position + 8;
+    if (bytes.size() - data < chunk_size) {
+      chunk_size = static_cast<std::uint32_t>(bytes.size() - data);
+    }
+    if (std::memcmp(&bytes[position], "fmt ", 4) == 0) {
+      if (chunk_size < 16 || le(bytes, data, 2) != 1) {
+        throw std::runtime_error{"'" + name + "' is not PCM"};
+      }
+      channels = le(bytes, data + 2, 2);
+      sample_width = (le(bytes, data + 14, 2) + 7) / 8;
+      have_format = true;
+    } else if (std::memcmp(&bytes[position], "data", 4) == 0) {
+      if (!have_format) {
+        throw std::runtime_error{"'" + name + "' has data before fmt"};
+      }
+      if (channels > 1) {
+        throw std::runtime_error{"Bank " + std::string{what} + " sample '" +
+                                 name + "' is not mono"};
+      }
+      if (sample_width != 1 && sample_width != 2) {
+        throw std::runtime_error{"Bank " + std::string{what} + " sample '" +
+                                 name + "' is not 8-bit or 16-bit PCM"};
+      }
+      width = static_cast<U8>(sample_width);
+      chunk_size -= chunk_size % width;
+      return std::vector<U8>{bytes.begin() + data,
+                             bytes.begin() + data + chunk_size};
+    }
+    // Chunks are word aligned
+    position = data + chunk_size + (chunk_size & 1);
+  }
+  throw std::runtime_error{"'" + name + "' has no data chunk"};
+}
+
+U8 parse_id(const std::string &key) {
+  auto end = static_cast<char *>(nullptr);
+  auto value = std::strtol(key.c_str(), &end, 10);
+  if (key.empty() || *end != '\0' || value < 0 || value > 0xFF) {
+    throw std::runtime_error{"bank.json key '" + key + "' is not 0-255"};
+  }
+  return static_cast<U8>(value);
+}
+
+// Truncates toward zero like Python's int(), and refuses what
+// struct.pack('<I') would
+U32 to_u32(const json &value) {
+  auto number = std::trunc(value.as_number());
+  if (!(number >= 0.0 && number <= 4294967295.0)) {
+    throw std::runtime_error{"bank.json value " + std::to_string(number) +
+                             " does not fit an unsigned 32-bit integer"};
+  }
+  return static_cast<U32>(number);
+}
+} // namespace
+
+bank bank::load(const std::filesystem::path &path) {
+  auto text = read_file(path / "bank.json");
+  auto parser = json_parser{.text = text, .position = 0};
+  auto root = parser.parse_value();
+  auto result = bank{};
+
+  for (const auto &[key, info] : root["drums"].object) {
+    auto &drum = result.drums.emplace_back(sample{
+        .id = parse_id(key),
+        .name = key,
+        .width = 1,
+        .frames = {},
+        .loop_start = 0,
+        .loop_end = 0,
+        .pitch = static_cast<F32>(info["pitch"].as_number()),
+        .gain_L = static_cast<F32>(info["gain"][0].as_number()),
+        .gain_R = static_cast<F32>(info["gain"][1].as_number())});
+    drum.frames =
+        read_wave(path / "drums" / (key + ".wav"), "drum", drum.width);
+  }
+  for (const auto &[key, info] : root["patches"].object) {
+    auto &patch = result.patches.emplace_back(sample{
+        .id = parse_id(key),
+        .name = key,
+        .width = 1,
+        .frames = {},
+        .loop_start = to_u32(info["start"]),
+        .loop_end = to_u32(info["end"]),
+        .pitch = static_cast<F32>(info["pitch"].as_number()),
+        .gain_L = static_cast<F32>(info["gain"][0].as_number()),
+        .gain_R = static_cast<F32>(info["gain"][1].as_number())});
+    patch.frames =
+        read_wave(path / "patches" / (key + ".wav"), "patch", patch.width);
+  }
+  return result;
+}
@@ -0,0 +1,285 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// MIDI to AxolotlSD sequencer dump conversion, mirrors export/export.py
+#include "convert.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+using namespace axolotlsd;
+using namespace axolotlsd::format;
+
+namespace {
+// ADPCM is not worth its noise when it saves fewer bytes than this
+constexpr static std::size_t ADPCM_MIN_SAVING = 256;
+// Looping patches this short are single-cycle waveforms, whose ADPCM noise
+// repeats every cycle and is heard as a tone
+constexpr static U32 ADPCM_MIN_LOOPED_FRAMES = 1024;
+
+// Same as int(real_time * RATE) in export.py
+U32 to_tick(double real_time) {
+  return static_cast<U32>(real_time * TICK_RATE);
+}
+
+// What to_tick drops, kept so loop points land on the exact output frame
+U16 to_tick_fraction(double real_time) {
+  auto ticks = real_time * TICK_RATE;
+  return static_cast<U16>((ticks - std::floor(ticks)) * 65536.0);
+}
+
+// Marker names that open or close the loop region, as used by most
+// trackers and game engines
+bool is_marker(const std::vector<U8> &text, const char *name) {
+  if (text.size() != std::strlen(name)) {
+    return false;
+  }
+  for (auto i = std::size_t{0}; i < text.size(); i++) {
+    if (std::tolower(text[i]) != std::tolower(name[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Picks how one bank entry's samples are stored, and remembers it for later
+// entries to reference
+struct sample_encoder {
+  const exporter::options &settings;
+  std::map<std::pair<codec, std::vector<U8>>, std::vector<U8>> seen;
+
+  template <typename T>
+  codec encode_as(const exporter::sample &entry, bool looped,
+                  std::vector<U8> &payload, std::string &log) {
+    if (settings.adpcm) {
+      auto frames = unpack_pcm<T>(entry.frames.data(), entry.frames.size());
+      payload = adpcm4_encode(frames);
+      auto snr = snr_db(frames,
+                        adpcm4_decode<T>(payload.data(), payload.size(),
+                                         entry.frame_count()));
+      if (looped && entry.frame_count() < ADPCM_MIN_LOOPED_FRAMES) {
+        log += " (kept as PCM, short loop)";
+      } else if (payload.size() + ADPCM_MIN_SAVING > entry.frames.size()) {
+        log += " (kept as PCM, small saving)";
+      } else if (snr < exporter::ADPCM_MIN_SNR_DB) {
+        log += " (kept as PCM, adpcm " + std::to_string(std::lround(snr)) +
+               " dB)";
+      } else {
+        log += " (adpcm " + std::to_string(payload.size()) + " bytes)";
+        return sample_format<T>::adpcm;
+      }
+    }
+    payload = entry.frames;
+    return sample_format<T>::pcm;
+  }
+
+  codec encode(const exporter::sample &entry, U8 kind,
+               std::vector<U8> &payload, std::string &log) {
+    auto looped = kind == REFERENCE_PATCH && entry.loop_start != NO_LOOP;
+    auto encoding_log = std::string{};
+    auto encoding =
+        entry.width == 2
+            ? encode_as<std::int16_t>(entry, looped, payload, encoding_log)
+            : encode_as<U8>(entry, looped, payload, encoding_log);
+    if (settings.deduplicate) {
+      // Keyed on what is stored, so an entry the rules keep as PCM never
+      // references an earlier lossy copy of the same samples
+      auto key = std::pair{encoding, payload};
+      auto found = seen.find(key);
+      if (found != seen.end()) {
+        payload = found->second;
+        log += " (same as " +
+               std::string{payload[0] == REFERENCE_DRUM ? "drum " : "patch "} +
+               std::to_string(payload[1]) + ")";
+        return codec::reference;
+      }
+      seen.emplace(std::move(key), std::vector<U8>{kind, entry.id});
+    }
+    log += encoding_log;
+    return encoding;
+  }
+};
+} // namespace
+
+std::vector<U8> exporter::convert(const midi::file &song,
+                                  const bank &samples,
+                                  const options &settings, std::string &log) {
+  if (!settings.wide_samples) {
+    for (const auto *entries : {&samples.drums, &samples.patches}) {
+      for (const auto &entry : *entries) {
+        if (entry.width == 2) {
+          throw std::runtime_error{
+              "sample '" + entry.name +
+              "' is 16-bit, which needs --16bit and a loader that reads "
+              "0x82/0x83 records"};
+        }
+      }
+    }
+  }
+
+  auto output = writer{};
+  output.header(TICK_RATE);
+  auto encoder = sample_encoder{.settings = settings, .seen = {}};
+  auto payload = std::vector<U8>{};
+
+  log += "Handling drum bank...\n";
+  for (const auto &drum : samples.drums) {
+    log += drum.name + ": " + std::to_string(drum.frame_count());
+    if (drum.width == 2) {
+      log += " 16-bit";
+    }
+    // 8-bit PCM keeps the plain record older loaders read
+    auto encoding = encoder.encode(drum, REFERENCE_DRUM, payload, log);
+    if (encoding == codec::pcm_u8) {
+      output.drum(drum.id, drum.frames, drum.pitch, drum.gain_L, drum.gain_R);
+    } else {
+      output.encoded_drum(drum.id, drum.frame_count(), drum.pitch,
+                          drum.gain_L, drum.gain_R, encoding, payload);
+    }
+    log += "\n";
+  }
+
+  log += "Handling patch bank...\n";
+  for (const auto &patch : samples.patches) {
+    log += patch.name + ": loop " + std::to_string(patch.loop_start) + "-" +
+           std::to_string(patch.loop_end) + " " +
+           std::to_string(patch.frame_count());
+    if (patch.width == 2) {
+      log += " 16-bit";
+    }
+    auto encoding = encoder.encode(patch, REFERENCE_PATCH, payload, log);
+    if (encoding == codec::pcm_u8) {
+      output.patch(patch.id, patch.frames, patch.loop_start, patch.loop_end,
+                   patch.pitch, patch.gain_L, patch.gain_R);
+    } else {
+      output.encoded_patch(patch.id, patch.frame_count(),
+                           patch.loop_start, patch.loop_end, patch.pitch,
+                           patch.gain_L, patch.gain_R, encoding, payload);
+    }
+    log += "\n";
+  }
+
+  // Like export.py the tempo carries over between tracks, and every tick is
+  // converted with whichever tempo was set last
+  auto tempo = std::uint32_t{500000};
+  auto end_of_track = std::optional<double>{};
+  auto loop_start = std::optional<double>{};
+  auto loop_end = std::optional<double>{};
+  auto time = std::uint64_t{0};
+
+  for (const auto &track : song.tracks) {
+    time = 0;
+    for (const auto &message : track.messages) {
+      time += message.delta;
+      if (message.is_meta()) {
+        switch (message.meta_type) {
+        case midi::META_SET_TEMPO: {
+          if (message.data.size() >= 3) {
+            tempo = (message.data[0] << 16) | (message.data[1] << 8) |
+                    message.data[2];
+            log += std::to_string(time) + " -> tempo " +
+                   std::to_string(tempo) + "\n";
+          }
+          break;
+        }
+        case midi::META_MARKER: {
+          auto at = midi::tick2second(time, song.ticks_per_beat, tempo);
+          if (is_marker(message.data, "loopStart") ||
+              is_marker(message.data, "loop_start")) {
+            loop_start = at;
+          } else if (is_marker(message.data, "loopEnd") ||
+                     is_marker(message.data, "loop_end")) {
+            loop_end = at;
+          }
+          break;
+        }
+        case midi::META_END_OF_TRACK: {
+          auto this_end = midi::tick2second(time, song.ticks_per_beat, tempo);
+          if (!end_of_track.has_value() || this_end > *end_of_track) {
+            end_of_track = this_end;
+          }
+          break;
+        }
+        default: {
+          break;
+        }
+        }
+        continue;
+      }
+
+      auto tick =
+          to_tick(midi::tick2second(time, song.ticks_per_beat, tempo));
+      switch (message.status < 0xF0 ? message.kind() : 0) {
+      case midi::NOTE_ON: {
+        if (settings.keyed_note_off && message.data[1] == 0) {
+          output.note_off_keyed(tick, message.channel(), message.data[0]);
+        } else {
+          output.note_on(tick, message.channel(), message.data[0],
+                         message.data[1]);
+        }
+        break;
+      }
+      case midi::NOTE_OFF: {
+        if (settings.keyed_note_off) {
+          output.note_off_keyed(tick, message.channel(), message.data[0]);
+        } else {
+          output.note_off(tick, message.channel());
+        }
+        break;
+      }
+      case midi::PITCHWHEEL: {
+        auto bend = (message.data[0] | (message.data[1] << 7)) - 8192;
+        output.pitch_bend(tick, message.channel(), bend);
+        break;
+      }
+      case midi::PROGRAM_CHANGE: {
+        output.program_change(tick, message.channel(), message.data[0]);
+        break;
+      }
+      default: {
+        break;
+      }
+      }
+    }
+  }
+
+  if (!end_of_track.has_value()) {
+    end_of_track = midi::tick2second(time, song.ticks_per_beat, tempo);
+  }
+  // Without a loop end marker the loop runs to the end of the song
+  if (loop_start.has_value() && !settings.loop_points) {
+    log += "loop markers ignored, --loop writes them\n";
+  } else if (loop_start.has_value()) {
+    auto end = loop_end.value_or(*end_of_track);
+    if (end > *loop_start) {
+      output.loop_start(to_tick(*loop_start), to_tick_fraction(*loop_start));
+      output.loop_end(to_tick(end), to_tick_fraction(end));
+      log += "loops " + std::to_string(*loop_start) + "-" +
+             std::to_string(end) + "\n";
+    } else {
+      log += "warning: loop end " + std::to_string(end) +
+             " is not after loop start " + std::to_string(*loop_start) +
+             ", no loop written\n";
+    }
+  }
+  output.end_of_track(to_tick(*end_of_track));
+  log += "ends at " + std::to_string(*end_of_track) + "\n";
+  return output.finish();
+}
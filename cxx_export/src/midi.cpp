@@ -0,0 +1,157 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Standard MIDI File reader
+#include "midi.hpp"
+#include <cstring>
+#include <stdexcept>
+
+using namespace axolotlsd::midi;
+
+namespace {
+struct cursor {
+  const std::vector<std::uint8_t> &bytes;
+  std::size_t position;
+
+  std::uint8_t u8() {
+    if (position >= bytes.size()) {
+      throw std::runtime_error{"MIDI file ends unexpectedly"};
+    }
+    return bytes[position++];
+  }
+  std::uint16_t u16_be() {
+    auto high = u8();
+    return (high << 8) | u8();
+  }
+  std::uint32_t u32_be() {
+    auto high = u16_be();
+    return (static_cast<std::uint32_t>(high) << 16) | u16_be();
+  }
+  std::uint32_t variable() {
+    auto value = std::uint32_t{0};
+    for (auto i = 0; i < 4; i++) {
+      auto byte = u8();
+      value = (value << 7) | (byte & 0x7F);
+      if ((byte & 0x80) == 0) {
+        break;
+      }
+    }
+    return value;
+  }
+  std::vector<std::uint8_t> take(std::size_t count) {
+    if (bytes.size() - position < count) {
+      throw std::runtime_error{"MIDI file ends unexpectedly"};
+    }
+    auto begin = bytes.begin() + position;
+    position += count;
+    return std::vector<std::uint8_t>{begin, begin + count};
+  }
+  bool chunk(const char *name) {
+    auto match = bytes.size() - position >= 4 &&
+                 std::memcmp(&bytes[position], name, 4) == 0;
+    position += 4;
+    return match;
+  }
+};
+
+// Total message length including the status byte, as in mido's specs
+std::size_t message_length(std::uint8_t status) {
+  if (status < 0xF0) {
+    switch (status & 0xF0) {
+    case 0xC0:
+    case 0xD0:
+      return 2;
+    default:
+      return 3;
+    }
+  }
+  switch (status) {
+  case 0xF1:
+  case 0xF3:
+    return 2;
+  case 0xF2:
+    return 3;
+  default:
+    return 1;
+  }
+}
+
+track read_track(cursor &reader) {
+  if (!reader.chunk("MTrk")) {
+    throw std::runtime_error{"no MTrk header at start of track"};
+  }
+  auto size = reader.u32_be();
+  auto start = reader.position;
+  auto result = track{};
+  auto last_status = std::uint8_t{0};
+  while (reader.position - start < size) {
+    auto msg = message{.delta = reader.variable(),
+                       .status = reader.u8(),
+                       .meta_type = 0,
+                       .data = {}};
+    if (msg.status < 0x80) {
+      // Running status, the byte we read was the first data byte
+      if (last_status == 0) {
+        throw std::runtime_error{"running status without last status"};
+      }
+      msg.data.emplace_back(msg.status);
+      msg.status = last_status;
+    } else if (msg.status != 0xFF) {
+      // Meta messages don't set running status
+      last_status = msg.status;
+    }
+
+    if (msg.status == 0xFF) {
+      msg.meta_type = reader.u8();
+      msg.data = reader.take(reader.variable());
+    } else if (msg.status == 0xF0 || msg.status == 0xF7) {
+      msg.data = reader.take(reader.variable());
+    } else {
+      auto remaining = message_length(msg.status) - 1 - msg.data.size();
+      for (auto i = std::size_t{0}; i < remaining; i++) {
+        msg.data.emplace_back(reader.u8());
+      }
+    }
+    result.messages.emplace_back(std::move(msg));
+  }
+  return result;
+}
+} // namespace
+
+file file::load(const std::vector<std::uint8_t> &bytes) {
+  auto reader = cursor{.bytes = bytes, .position = 0};
+  if (!reader.chunk("MThd")) {
+    throw std::runtime_error{"MThd not found, probably not a MIDI file"};
+  }
+  auto header_size = reader.u32_be();
+  auto header_start = reader.position;
+  auto result = file{};
+  result.format = reader.u16_be();
+  auto track_count = reader.u16_be();
+  result.ticks_per_beat = reader.u16_be();
+  // Tick times are worked out from ticks per beat, the high bit would mean
+  // SMPTE frames per second instead
+  if (result.ticks_per_beat == 0) {
+    throw std::runtime_error{"MIDI division is zero"};
+  }
+  if (result.ticks_per_beat & 0x8000) {
+    throw std::runtime_error{"SMPTE time division is not supported"};
+  }
+  reader.position = header_start + header_size;
+  for (auto i = 0; i < track_count && reader.position < bytes.size(); i++) {
+    result.tracks.emplace_back(read_track(reader));
+  }
+  return result;
+}
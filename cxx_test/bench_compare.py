@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# =============================================================================
+#   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#       http://www.apache.org/licenses/LICENSE-2.0
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+# =============================================================================
+#   Compares two axolotlsd_bench JSON runs, fails on regressions
+import sys
+import json
+import statistics
+
+THRESHOLD = 0.05  # fraction slower than the baseline that counts as a loss
+
+
+def load_runs(path):
+    """Real times of every repetition, by benchmark name"""
+    with open(path) as reader:
+        benchmarks = json.load(reader)["benchmarks"]
+    runs = {}
+    for bench in benchmarks:
+        if bench.get("run_type", "iteration") != "iteration":
+            continue  # aggregates are recomputed from the repetitions
+        name = bench.get("run_name", bench["name"])
+        runs.setdefault(name, []).append(bench["real_time"])
+    return runs
+
+
+if len(sys.argv) not in (3, 4):
+    print(f"Usage: {sys.argv[0]} baseline.json contender.json [threshold]")
+    sys.exit(2)
+
+threshold = float(sys.argv[3]) if len(sys.argv) == 4 else THRESHOLD
+baseline = load_runs(sys.argv[1])
+contender = load_runs(sys.argv[2])
+
+regressions = 0
+missing = 0
+print(f"{'benchmark':<28} {'baseline':>14} {'contender':>14} {'change':>9}"
+      f" {'runs':>5}")
+for name, old_runs in baseline.items():
+    old = statistics.median(old_runs)
+    new_runs = contender.get(name)
+    if new_runs is None:
+        # Renamed, removed or crashed, any of which must not pass the gate
+        print(f"{name:<28} {old:>11.1f} ns {'MISSING':>14}")
+        missing += 1
+        continue
+    new = statistics.median(new_runs)
+    change = (new - old) / old
+    marker = ""
+    if change > threshold:
+        marker = " REGRESSION"
+        regressions += 1
+    print(f"{name:<28} {old:>11.1f} ns {new:>11.1f} ns {change:>+8.1%}"
+          f" {min(len(old_runs), len(new_runs)):>5}{marker}")
+
+for name in contender.keys() - baseline.keys():
+    new = statistics.median(contender[name])
+    print(f"{name:<28} {'new':>14} {new:>11.1f} ns")
+
+if min(len(runs) for runs in [*baseline.values(), *contender.values()]) < 3:
+    print("warning: fewer than 3 repetitions, medians may be noisy")
+if regressions > 0:
+    print(f"{regressions} regression(s) over {threshold:.0%}")
+if missing > 0:
+    print(f"{missing} benchmark(s) missing from {sys.argv[2]}")
+if regressions > 0 or missing > 0:
+    sys.exit(1)
@@ -0,0 +1,537 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Micro-benchmarks per subsystem, emits Google Benchmark compatible JSON
+#include "configuration.hpp"
+#include "sfx/sfx00.raw.h"
+#include <algorithm>
+#include <axolotlsd.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+constexpr static auto FILL_FRAMES = 1024;
+constexpr static auto SAMPLE_RATE = 44100;
+constexpr static auto SEQUENCER_RATE = 60;
+constexpr static auto MIN_SECONDS = 0.5;
+// Runs per benchmark, bench_compare.py compares their medians
+constexpr static auto DEFAULT_REPETITIONS = 5;
+
+// Keeps the optimizer from discarding rendered output
+static volatile axolotlsd::F32 sink;
+
+// ============================================================================
+// Synthetic songs, written the same way export/export.py does
+// ============================================================================
+struct song_writer {
+  std::vector<axolotlsd::U8> bytes;
+
+  void u8(std::uint8_t value) { bytes.emplace_back(value); }
+  void u16(std::uint16_t value) {
+    for (auto i = 0; i < 2; i++) {
+      u8((value >> (i * 8)) & 0xFF);
+    }
+  }
+  void u32(std::uint32_t value) {
+    for (auto i = 0; i < 4; i++) {
+      u8((value >> (i * 8)) & 0xFF);
+    }
+  }
+  void f32(float value) {
+    auto bits = std::uint32_t{0};
+    std::memcpy(&bits, &value, sizeof(bits));
+    u32(bits);
+  }
+
+  song_writer() {
+    bytes.insert(bytes.end(), {'A', 'X', 'S', 'D'});
+    u8(0xFC);
+    u16(0x0003);
+    u8(0xFD);
+    u32(SEQUENCER_RATE);
+    // Patch 0, a looping 8-bit sine
+    constexpr auto frames = 256;
+    u8(0x80);
+    u8(0);
+    u32(frames);
+    u32(0);
+    u32(frames - 1);
+    f32(1.0f);
+    f32(0.5f);
+    f32(0.5f);
+    for (auto i = 0; i < frames; i++) {
+      u8(static_cast<std::uint8_t>(
+          128.0 + 100.0 * std::sin(i * 2.0 * 3.14159265358979 / frames)));
+    }
+  }
+
+  void note_on(std::uint32_t tick, std::uint8_t channel, std::uint8_t note) {
+    u8(0x01);
+    u32(tick);
+    u8(channel);
+    u8(note);
+    u8(100);
+  }
+  void note_off(std::uint32_t tick, std::uint8_t channel) {
+    u8(0x02);
+    u32(tick);
+    u8(channel);
+  }
+  void program_change(std::uint32_t tick, std::uint8_t channel) {
+    u8(0x04);
+    u32(tick);
+    u8(channel);
+    u8(0);
+  }
+  std::vector<axolotlsd::U8> finish(std::uint32_t tick) {
+    u8(0xFE);
+    u32(tick);
+    return bytes;
+  }
+};
+
+// Notes held for `ticks`, `voices` of them spread over the melodic channels
+static std::vector<axolotlsd::U8> held_song(int voices, std::uint32_t ticks) {
+  auto writer = song_writer{};
+  for (auto channel = 0; channel < 16; channel++) {
+    if (channel != 9) {
+      writer.program_change(0, channel);
+    }
+  }
+  for (auto i = 0; i < voices; i++) {
+    auto channel = i % 15;
+    writer.note_on(0, channel < 9 ? channel : channel + 1, 48 + i);
+  }
+  return writer.finish(ticks);
+}
+
+// A note on and a note off on every melodic channel, every tick
+static std::vector<axolotlsd::U8> dense_song(std::uint32_t ticks) {
+  auto writer = song_writer{};
+  for (auto tick = std::uint32_t{0}; tick < ticks; tick++) {
+    for (auto channel = 0; channel < 16; channel++) {
+      if (channel == 9) {
+        continue;
+      }
+      writer.note_on(tick, channel, 60 + channel);
+      writer.note_off(tick, channel);
+    }
+  }
+  return writer.finish(ticks);
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+struct bench_result {
+  std::string name;
+  // Which run of the benchmark this is, medians are written with -1
+  int repetition_index;
+  std::uint64_t iterations;
+  double real_ns;
+  double cpu_ns;
+  double items_per_iteration;
+  const char *items_label;
+};
+
+// Benchmarks call start() once their setup is done, setup is not timed
+struct bench_state {
+  std::uint64_t iterations;
+  std::clock_t cpu_start;
+  std::chrono::steady_clock::time_point real_start;
+
+  void start() {
+    cpu_start = std::clock();
+    real_start = std::chrono::steady_clock::now();
+  }
+};
+
+struct bench_case {
+  std::string name;
+  double items_per_iteration;
+  const char *items_label;
+  std::function<void(bench_state &)> run;
+};
+
+// Times `iterations` runs of a benchmark
+static bench_result run_once(const bench_case &bench, std::uint64_t iterations,
+                             int repetition_index) {
+  auto state = bench_state{
+      .iterations = iterations, .cpu_start = {}, .real_start = {}};
+  state.start();
+  bench.run(state);
+  auto real = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            state.real_start)
+                  .count();
+  auto cpu =
+      static_cast<double>(std::clock() - state.cpu_start) / CLOCKS_PER_SEC;
+  return bench_result{.name = bench.name,
+                      .repetition_index = repetition_index,
+                      .iterations = iterations,
+                      .real_ns = real * 1.0e9 / iterations,
+                      .cpu_ns = cpu * 1.0e9 / iterations,
+                      .items_per_iteration = bench.items_per_iteration,
+                      .items_label = bench.items_label};
+}
+
+// Finds an iteration count that runs for at least MIN_SECONDS, then times
+// that many iterations `repetitions` times
+static std::vector<bench_result> measure(const bench_case &bench,
+                                         int repetitions) {
+  auto iterations = std::uint64_t{1};
+  while (true) {
+    auto result = run_once(bench, iterations, 0);
+    auto real = result.real_ns * iterations / 1.0e9;
+    if (real >= MIN_SECONDS || iterations >= (1ull << 32)) {
+      break;
+    }
+    // Aim a little past the minimum time so the next run is the last one
+    auto scale = real > 0.0 ? MIN_SECONDS * 1.4 / real : 10.0;
+    iterations = static_cast<std::uint64_t>(
+        iterations * (scale > 10.0 ? 10.0 : (scale < 2.0 ? 2.0 : scale)));
+  }
+  auto runs = std::vector<bench_result>{};
+  for (auto i = 0; i < repetitions; i++) {
+    runs.emplace_back(run_once(bench, iterations, i));
+  }
+  return runs;
+}
+
+// Median of each time over the runs of one benchmark
+static bench_result median(const std::vector<bench_result> &runs) {
+  auto middle = [&](auto member) {
+    auto values = std::vector<double>{};
+    for (const auto &run : runs) {
+      values.emplace_back(run.*member);
+    }
+    std::sort(values.begin(), values.end());
+    auto half = values.size() / 2;
+    return values.size() % 2 == 1 ? values[half]
+                                  : (values[half - 1] + values[half]) / 2.0;
+  };
+  auto result = runs.front();
+  result.repetition_index = -1;
+  result.real_ns = middle(&bench_result::real_ns);
+  result.cpu_ns = middle(&bench_result::cpu_ns);
+  return result;
+}
+
+static std::vector<axolotlsd::U8> read_file(const char *path) {
+  auto reader = std::ifstream{path, std::ios::binary};
+  return std::vector<axolotlsd::U8>{std::istreambuf_iterator<char>{reader},
+                                    std::istreambuf_iterator<char>{}};
+}
+
+static axolotlsd::environment echo_environment() {
+  auto filter = axolotlsd::environment::parse_sfc_echo(
+      {0x0c, 0x21, 0x2b, 0x2b, 0x13, 0xfe, 0xf3, 0xf9});
+  return axolotlsd::environment{.feedback_L = 0.6f,
+                                .feedback_R = 0.6f,
+                                .wet_L = 0.66f,
+                                .wet_R = 0.66f,
+                                .cursor_max = 0x1000,
+                                .fir_filter = filter};
+}
+
+// Writes a song lasting the given number of sequencer ticks
+using song_source = std::function<std::vector<axolotlsd::U8>(std::uint32_t)>;
+
+static song_source held(int voices) {
+  return [voices](std::uint32_t ticks) { return held_song(voices, ticks); };
+}
+
+// Sequencer ticks that `iterations` buffers of `frames` play through, plus a
+// second so the song is still playing on the last buffer
+static std::uint32_t song_ticks(std::uint64_t iterations, int frames) {
+  auto ticks = iterations * frames * SEQUENCER_RATE / SAMPLE_RATE;
+  return static_cast<std::uint32_t>(
+      std::min<std::uint64_t>(ticks + SEQUENCER_RATE, 0xFFFFFFFF));
+}
+
+// Renders a song one `frames` buffer per iteration, the song is written for
+// the iteration count so playback never runs off its end
+static std::function<void(bench_state &)>
+render_bench(song_source song, bool echo, bool play, int sfx_per_iteration,
+             int frames = FILL_FRAMES) {
+  return [song = std::move(song), echo, play, sfx_per_iteration,
+          frames](bench_state &state) {
+    auto song_bytes = song(song_ticks(state.iterations, frames));
+    auto player = axolotlsd::player(32, SAMPLE_RATE, true);
+    if (echo) {
+      player.put_environment(echo_environment());
+    }
+    player.load(axolotlsd::song::load(song_bytes));
+    if (play) {
+      player.play();
+    }
+    auto sfx00 = axolotlsd::sfx::load_xxd_format(sfx00_raw, sfx00_raw_len);
+    auto buffer_vector = std::vector<axolotlsd::F32>{};
+    buffer_vector.resize(frames * 2, 0.0f);
+    state.start();
+    for (auto i = std::uint64_t{0}; i < state.iterations; i++) {
+      for (auto j = 0; j < sfx_per_iteration; j++) {
+        player.queue_sfx(axolotlsd::sfx{sfx00});
+      }
+      player.tick(buffer_vector);
+    }
+    sink = buffer_vector[0];
+  };
+}
+
+static std::vector<bench_case> make_cases(const char *song_path) {
+  auto cases = std::vector<bench_case>{};
+
+  // song::load by file size
+  for (auto ticks : {16u, 256u, 4096u}) {
+    auto song_bytes = dense_song(ticks);
+    auto size = static_cast<double>(song_bytes.size());
+    cases.emplace_back(bench_case{
+        .name = "song_load/" + std::to_string(song_bytes.size()),
+        .items_per_iteration = size,
+        .items_label = "bytes",
+        .run = [song_bytes](bench_state &state) {
+          for (auto i = std::uint64_t{0}; i < state.iterations; i++) {
+            auto song = axolotlsd::song::load(song_bytes);
+            static_cast<void>(song);
+          }
+        }});
+  }
+  auto funk_bytes = read_file(song_path);
+  cases.emplace_back(bench_case{
+      .name = "song_load/funk",
+      .items_per_iteration = static_cast<double>(funk_bytes.size()),
+      .items_label = "bytes",
+      .run = [funk_bytes](bench_state &state) {
+        for (auto i = std::uint64_t{0}; i < state.iterations; i++) {
+          auto song = axolotlsd::song::load(funk_bytes);
+          static_cast<void>(song);
+        }
+      }});
+
+  // 30 events per sequencer tick
+  auto events_per_buffer =
+      30.0 * SEQUENCER_RATE * FILL_FRAMES / static_cast<double>(SAMPLE_RATE);
+  cases.emplace_back(
+      bench_case{.name = "event_dispatch",
+                 .items_per_iteration = events_per_buffer,
+                 .items_label = "events",
+                 .run = render_bench(dense_song, false, true, 0)});
+
+  cases.emplace_back(bench_case{.name = "mix/silent",
+                                .items_per_iteration = FILL_FRAMES,
+                                .items_label = "frames",
+                                .run = render_bench(held(0), false, true,
+                                                    0)});
+  cases.emplace_back(bench_case{.name = "mix/single_voice",
+                                .items_per_iteration = FILL_FRAMES,
+                                .items_label = "frames",
+                                .run = render_bench(held(1), false, true,
+                                                    0)});
+  cases.emplace_back(bench_case{.name = "mix/full_polyphony",
+                                .items_per_iteration = FILL_FRAMES,
+                                .items_label = "frames",
+                                .run = render_bench(held(32), false,
+                                                    true, 0)});
+  cases.emplace_back(bench_case{.name = "echo_fir",
+                                .items_per_iteration = FILL_FRAMES,
+                                .items_label = "frames",
+                                .run = render_bench(held(0), true, true,
+                                                    0)});
+  cases.emplace_back(bench_case{.name = "sfx_mix/4_per_buffer",
+                                .items_per_iteration = FILL_FRAMES,
+                                .items_label = "frames",
+                                .run = render_bench(held(0), false,
+                                                    true, 4)});
+
+  // Fixed cost per tick call, at the buffer sizes low latency backends use
+  for (auto frames : {32, 64, 128, FILL_FRAMES}) {
+    cases.emplace_back(bench_case{
+        .name = "tick_call/" + std::to_string(frames),
+        .items_per_iteration = static_cast<double>(frames),
+        .items_label = "frames",
+        .run = render_bench(held(8), true, true, 0, frames)});
+  }
+
+  // Room changes, swapping between two echo presets before every buffer
+  cases.emplace_back(bench_case{
+      .name = "environment/switch",
+      .items_per_iteration = FILL_FRAMES,
+      .items_label = "frames",
+      .run = [](bench_state &state) {
+        auto song_bytes = held_song(8, song_ticks(state.iterations,
+                                                  FILL_FRAMES));
+        auto small_room = echo_environment();
+        auto large_room = echo_environment();
+        large_room.cursor_max = 0x1800;
+        auto player = axolotlsd::player(32, SAMPLE_RATE, true);
+        player.load(axolotlsd::song::load(song_bytes));
+        player.play();
+        auto buffer_vector = std::vector<axolotlsd::F32>{};
+        buffer_vector.resize(FILL_FRAMES * 2, 0.0f);
+        state.start();
+        for (auto i = std::uint64_t{0}; i < state.iterations; i++) {
+          player.put_environment(i % 2 == 0 ? small_room : large_room);
+          player.tick(buffer_vector);
+        }
+        sink = buffer_vector[0];
+      }});
+
+  // Session churn, a player with echo constructed and torn down each time
+  cases.emplace_back(bench_case{
+      .name = "player/create_destroy",
+      .items_per_iteration = 1.0,
+      .items_label = "players",
+      .run = [](bench_state &state) {
+        auto environment = echo_environment();
+        state.start();
+        for (auto i = std::uint64_t{0}; i < state.iterations; i++) {
+          auto player = axolotlsd::player(32, SAMPLE_RATE, true);
+          player.put_environment(environment);
+        }
+      }});
+
+  cases.emplace_back(bench_case{
+      .name = "parse_sfc_echo",
+      .items_per_iteration = 1.0,
+      .items_label = "filters",
+      .run = [](bench_state &state) {
+        for (auto i = std::uint64_t{0}; i < state.iterations; i++) {
+          auto filter = axolotlsd::environment::parse_sfc_echo(
+              {0x0c, 0x21, 0x2b, 0x2b, 0x13, 0xfe, 0xf3,
+               static_cast<axolotlsd::U8>(i)});
+          sink = filter[0];
+        }
+      }});
+  return cases;
+}
+
+static void write_json(std::FILE *writer,
+                       const std::vector<bench_result> &results,
+                       int repetitions) {
+  std::fprintf(writer, "{\n  \"context\": {\n");
+  std::fprintf(writer,
+               "    \"library_version\": \"" axolotlsd_VSTRING_FULL "\",\n");
+  std::fprintf(writer, "    \"sample_rate\": %d,\n", SAMPLE_RATE);
+  std::fprintf(writer, "    \"fill_frames\": %d\n  },\n", FILL_FRAMES);
+  std::fprintf(writer, "  \"benchmarks\": [\n");
+  for (auto i = std::size_t{0}; i < results.size(); i++) {
+    const auto &result = results[i];
+    std::fprintf(writer, "    {\n");
+    if (result.repetition_index < 0) {
+      std::fprintf(writer, "      \"name\": \"%s_median\",\n",
+                   result.name.c_str());
+      std::fprintf(writer, "      \"run_type\": \"aggregate\",\n");
+      std::fprintf(writer, "      \"aggregate_name\": \"median\",\n");
+    } else {
+      std::fprintf(writer, "      \"name\": \"%s\",\n", result.name.c_str());
+      std::fprintf(writer, "      \"run_type\": \"iteration\",\n");
+      std::fprintf(writer, "      \"repetition_index\": %d,\n",
+                   result.repetition_index);
+    }
+    std::fprintf(writer, "      \"run_name\": \"%s\",\n",
+                 result.name.c_str());
+    std::fprintf(writer, "      \"repetitions\": %d,\n", repetitions);
+    std::fprintf(writer, "      \"iterations\": %llu,\n",
+                 static_cast<unsigned long long>(result.iterations));
+    std::fprintf(writer, "      \"real_time\": %.3f,\n", result.real_ns);
+    std::fprintf(writer, "      \"cpu_time\": %.3f,\n", result.cpu_ns);
+    std::fprintf(writer, "      \"time_unit\": \"ns\",\n");
+    std::fprintf(writer, "      \"items_label\": \"%s\",\n",
+                 result.items_label);
+    std::fprintf(writer, "      \"items_per_second\": %.3f\n",
+                 result.items_per_iteration * 1.0e9 / result.real_ns);
+    std::fprintf(writer, "    }%s\n", i + 1 < results.size() ? "," : "");
+  }
+  std::fprintf(writer, "  ]\n}\n");
+}
+
+static void usage(const char *self) {
+  std::fprintf(stderr,
+               "Usage: %s <song.axsd> [--json <out.json>] [--filter <s>] "
+               "[--repetitions <n>]\n",
+               self);
+}
+
+int main(int argc, char **argv) {
+  std::fprintf(stderr,
+               "AxolotlSD C++ benchmark " axolotlsd_test_VSTRING_FULL "\n");
+  std::fprintf(stderr, "Using AxolotlSD C++ lib " axolotlsd_VSTRING_FULL "\n");
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *json_path = nullptr;
+  const char *filter = nullptr;
+  auto repetitions = DEFAULT_REPETITIONS;
+  for (auto i = 2; i < argc; i += 2) {
+    if (i + 1 == argc) {
+      std::fprintf(stderr, "Option '%s' needs a value\n", argv[i]);
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (std::strcmp(argv[i], "--json") == 0) {
+      json_path = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--filter") == 0) {
+      filter = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--repetitions") == 0) {
+      repetitions = std::atoi(argv[i + 1]);
+      if (repetitions < 1) {
+        std::fprintf(stderr, "Repetitions must be at least 1\n");
+        return EXIT_FAILURE;
+      }
+    } else {
+      std::fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto results = std::vector<bench_result>{};
+  for (const auto &bench : make_cases(argv[1])) {
+    if (filter != nullptr && bench.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    auto runs = measure(bench, repetitions);
+    auto result = median(runs);
+    std::fprintf(stderr, "%-28s %14.1f ns %12llu it %14.1f %s/s\n",
+                 result.name.c_str(), result.real_ns,
+                 static_cast<unsigned long long>(result.iterations),
+                 result.items_per_iteration * 1.0e9 / result.real_ns,
+                 result.items_label);
+    results.insert(results.end(), runs.begin(), runs.end());
+    results.emplace_back(std::move(result));
+  }
+
+  if (json_path != nullptr) {
+    auto writer = std::fopen(json_path, "w");
+    if (writer == nullptr) {
+      std::fprintf(stderr, "Could not write '%s'\n", json_path);
+      return EXIT_FAILURE;
+    }
+    write_json(writer, results, repetitions);
+    std::fclose(writer);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+// ============================================================================
+//   Copyright 2023 Roland Metivier <metivier.roland@chlorophyt.us>
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+// ============================================================================
+// Golden output regression test, renders headless and compares to references
+#include "configuration.hpp"
+#include "sfx/sfx00.raw.h"
+#include <algorithm>
+#include <axolotlsd.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+constexpr static auto FILL_FRAMES = 1800;
+constexpr static auto RENDER_SECONDS = 30;
+constexpr static auto ENVELOPE_BLOCK = 2048;
+constexpr static auto TOLERANCE_ABS = 1.0e-4;
+constexpr static auto TOLERANCE_REL = 1.0e-3;
+// Largest difference in any one block's peak sample, a click or dropout moves
+// the peak long before it moves the RMS
+constexpr static auto TOLERANCE_PEAK = 1.0e-3;
+
+struct golden_case {
+  const char *name;
+  std::uint32_t sample_rate;
+  bool stereo;
+  bool echo;
+  bool music;
+  bool sfx;
+};
+
+constexpr static golden_case CASES[] = {
+    {"funk_22050_stereo_dry", 22050, true, false, true, false},
+    {"funk_22050_stereo_echo", 22050, true, true, true, false},
+    {"funk_22050_mono_echo", 22050, false, true, true, false},
+    {"funk_44100_stereo_dry", 44100, true, false, true, false},
+    {"funk_44100_mono_dry", 44100, false, false, true, false},
+    {"sfx00_22050_stereo", 22050, true, false, false, true},
+    {"sfx00_44100_stereo_echo", 44100, true, true, false, true},
+    {"mixed_22050_stereo_echo", 22050, true, true, true, true},
+};
+
+/// @brief RMS and peak of one block of one channel
+struct golden_block {
+  double rms;
+  double peak;
+};
+
+struct golden_result {
+  std::uint64_t hash;
+  std::uint64_t samples;
+  // One envelope per output channel, so a swapped or broken pan shows up
+  std::vector<std::vector<golden_block>> envelopes;
+};
+
+static std::vector<axolotlsd::U8> read_file(const std::filesystem::path &path) {
+  auto reader = std::ifstream{path, std::ios::binary};
+  return std::vector<axolotlsd::U8>{std::istreambuf_iterator<char>{reader},
+                                    std::istreambuf_iterator<char>{}};
+}
+
+// FNV-1a over the raw bit patterns, any change in output changes the hash
+static std::uint64_t fnv1a(std::uint64_t hash, const axolotlsd::F32 *data,
+                           std::size_t count) {
+  for (auto i = std::size_t{0}; i < count; i++) {
+    auto bits = std::uint32_t{0};
+    std::memcpy(&bits, &data[i], sizeof(bits));
+    for (auto shift = 0; shift < 32; shift += 8) {
+      hash ^= (bits >> shift) & 0xFF;
+      hash *= 0x100000001B3ull;
+    }
+  }
+  return hash;
+}
+
+static golden_result render(const golden_case &test,
+                            const std::vector<axolotlsd::U8> &song_bytes) {
+  auto player = axolotlsd::player(32, test.sample_rate, test.stereo);
+  if (test.echo) {
+    auto filter = axolotlsd::environment::parse_sfc_echo(
+        {0x0c, 0x21, 0x2b, 0x2b, 0x13, 0xfe, 0xf3, 0xf9});
+    player.put_environment(axolotlsd::environment{.feedback_L = 0.6f,
+                                                  .feedback_R = 0.6f,
+                                                  .wet_L = 0.66f,
+                                                  .wet_R = 0.66f,
+                                                  .cursor_max = 0x1000,
+                                                  .fir_filter = filter});
+  }
+  player.load(axolotlsd::song::load(song_bytes));
+  player.master_volume = 0.25f;
+  if (test.music) {
+    player.play();
+  }
+  if (test.sfx) {
+    auto sfx00 = axolotlsd::sfx::load_xxd_format(sfx00_raw, sfx00_raw_len);
+    sfx00.pan_L = 1.0f;
+    sfx00.pan_R = 0.0f;
+    player.queue_sfx(axolotlsd::sfx{sfx00});
+    sfx00.pan_L = 0.0f;
+    sfx00.pan_R = 1.0f;
+    player.queue_sfx(axolotlsd::sfx{sfx00});
+  }
+
+  auto channels = test.stereo ? 2 : 1;
+  auto buffer_vector = std::vector<axolotlsd::F32>{};
+  buffer_vector.resize(FILL_FRAMES * channels, 0.0f);
+
+  auto result = golden_result{.hash = 0xCBF29CE484222325ull,
+                              .samples = 0,
+                              .envelopes = {}};
+  result.envelopes.resize(channels);
+  auto block_sum = std::vector<double>(channels, 0.0);
+  auto block_peak = std::vector<double>(channels, 0.0);
+  auto block_fill = 0;
+  auto close_block = [&]() {
+    for (auto c = 0; c < channels; c++) {
+      result.envelopes[c].emplace_back(golden_block{
+          .rms = std::sqrt(block_sum[c] / block_fill), .peak = block_peak[c]});
+      block_sum[c] = 0.0;
+      block_peak[c] = 0.0;
+    }
+    block_fill = 0;
+  };
+  auto total_frames = std::uint64_t{test.sample_rate} * RENDER_SECONDS;
+  for (auto frames = std::uint64_t{0}; frames < total_frames;
+       frames += FILL_FRAMES) {
+    player.tick(buffer_vector);
+    result.hash =
+        fnv1a(result.hash, buffer_vector.data(), buffer_vector.size());
+    // Interleaved frames, blocks count frames not samples
+    for (auto i = std::size_t{0}; i < buffer_vector.size(); i += channels) {
+      for (auto c = 0; c < channels; c++) {
+        auto sample = static_cast<double>(buffer_vector[i + c]);
+        block_sum[c] += sample * sample;
+        block_peak[c] = std::max(block_peak[c], std::fabs(sample));
+      }
+      if (++block_fill == ENVELOPE_BLOCK) {
+        close_block();
+      }
+    }
+    result.samples += buffer_vector.size();
+  }
+  if (block_fill > 0) {
+    close_block();
+  }
+  return result;
+}
+
+static bool write_reference(const std::filesystem::path &path,
+                            const golden_result &result) {
+  auto writer = std::fopen(path.string().c_str(), "w");
+  if (writer == nullptr) {
+    return false;
+  }
+  std::fprintf(writer, "hash %016llx\n",
+               static_cast<unsigned long long>(result.hash));
+  std::fprintf(writer, "samples %llu\n",
+               static_cast<unsigned long long>(result.samples));
+  std::fprintf(writer, "channels %zu\n", result.envelopes.size());
+  for (const auto &envelope : result.envelopes) {
+    for (const auto &block : envelope) {
+      std::fprintf(writer, "block %.9g %.9g\n", block.rms, block.peak);
+    }
+  }
+  std::fclose(writer);
+  return true;
+}
+
+static bool read_reference(const std::filesystem::path &path,
+                           golden_result &result) {
+  auto reader = std::fopen(path.string().c_str(), "r");
+  if (reader == nullptr) {
+    return false;
+  }
+  auto hash = 0ull;
+  auto samples = 0ull;
+  auto channels = std::size_t{0};
+  auto ok = std::fscanf(reader, "hash %llx\n", &hash) == 1 &&
+            std::fscanf(reader, "samples %llu\n", &samples) == 1 &&
+            std::fscanf(reader, "channels %zu\n", &channels) == 1 &&
+            channels > 0 && channels <= 2;
+  auto blocks = std::vector<golden_block>{};
+  auto block = golden_block{.rms = 0.0, .peak = 0.0};
+  while (ok && std::fscanf(reader, "block %lf %lf\n", &block.rms,
+                           &block.peak) == 2) {
+    blocks.emplace_back(block);
+  }
+  std::fclose(reader);
+  // Channels are written one after another, each the same length
+  if (ok && blocks.size() % channels == 0) {
+    auto per_channel = blocks.size() / channels;
+    for (auto c = std::size_t{0}; c < channels; c++) {
+      result.envelopes.emplace_back(blocks.begin() + c * per_channel,
+                                    blocks.begin() + (c + 1) * per_channel);
+    }
+  } else {
+    ok = false;
+  }
+  result.hash = hash;
+  result.samples = samples;
+  return ok;
+}
+
+// Exact hash match passes outright, otherwise every channel's RMS envelope
+// and block peaks have to be within tolerance so harmless floating point
+// reordering does not fail
+static bool compare(const golden_case &test, const golden_result &expected,
+                    const golden_result &actual) {
+  if (expected.hash == actual.hash) {
+    std::fprintf(stderr, "%s: bit-exact\n", test.name);
+    return true;
+  }
+  if (expected.samples != actual.samples ||
+      expected.envelopes.size() != actual.envelopes.size()) {
+    std::fprintf(stderr,
+                 "%s: shape differs (%llu samples in %zu channels vs %llu in "
+                 "%zu)\n",
+                 test.name, static_cast<unsigned long long>(actual.samples),
+                 actual.envelopes.size(),
+                 static_cast<unsigned long long>(expected.samples),
+                 expected.envelopes.size());
+    return false;
+  }
+  for (auto c = std::size_t{0}; c < expected.envelopes.size(); c++) {
+    const auto &want = expected.envelopes[c];
+    const auto &got = actual.envelopes[c];
+    if (want.size() != got.size()) {
+      std::fprintf(stderr, "%s: channel %zu length differs\n", test.name, c);
+      return false;
+    }
+    for (auto i = std::size_t{0}; i < want.size(); i++) {
+      auto rms_error = std::fabs(want[i].rms - got[i].rms) -
+                       TOLERANCE_REL * std::fabs(want[i].rms);
+      if (rms_error > TOLERANCE_ABS) {
+        std::fprintf(stderr,
+                     "%s: channel %zu RMS differs at block %zu (%.9g vs "
+                     "%.9g)\n",
+                     test.name, c, i, got[i].rms, want[i].rms);
+        return false;
+      }
+      if (std::fabs(want[i].peak - got[i].peak) > TOLERANCE_PEAK) {
+        std::fprintf(stderr,
+                     "%s: channel %zu peak differs at block %zu (%.9g vs "
+                     "%.9g)\n",
+                     test.name, c, i, got[i].peak, want[i].peak);
+        return false;
+      }
+    }
+  }
+  std::fprintf(stderr, "%s: within tolerance\n", test.name);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  std::fprintf(stderr,
+               "AxolotlSD C++ golden " axolotlsd_test_VSTRING_FULL "\n");
+  std::fprintf(stderr, "Using AxolotlSD C++ lib " axolotlsd_VSTRING_FULL "\n");
+
+  auto record = argc == 4 && std::strcmp(argv[3], "--record") == 0;
+  if (argc != 3 && !record) {
+    std::fprintf(stderr, "Usage: %s <song.axsd> <golden dir> [--record]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto song_bytes = read_file(argv[1]);
+  if (song_bytes.empty()) {
+    std::fprintf(stderr, "Could not read song '%s'\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  auto golden_dir = std::filesystem::path{argv[2]};
+  if (record) {
+    std::filesystem::create_directories(golden_dir);
+  }
+
+  auto failures = 0;
+  for (const auto &test : CASES) {
+    auto path = golden_dir / (std::string{test.name} + ".golden");
+    auto actual = render(test, song_bytes);
+    if (record) {
+      if (!write_reference(path, actual)) {
+        std::fprintf(stderr, "%s: could not write reference\n", test.name);
+        failures++;
+      } else {
+        std::fprintf(stderr, "%s: recorded %016llx\n", test.name,
+                     static_cast<unsigned long long>(actual.hash));
+      }
+      continue;
+    }
+    auto expected = golden_result{};
+    if (!read_reference(path, expected)) {
+      // A missing reference fails, a skipped check would pass unnoticed
+      std::fprintf(stderr, "%s: no reference, run with --record\n",
+                   test.name);
+      failures++;
+      continue;
+    }
+    if (!compare(test, expected, actual)) {
+      failures++;
+    }
+  }
+
+  return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}